@@ -0,0 +1,276 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Daemon.cpp
+ * @brief Long-running slicing service on a Unix domain socket
+ *
+ * @author Karl Nilsson
+ */
+
+#include "Daemon.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <spdlog/sinks/base_sink.h>
+
+#include <sse/Job.hpp>
+
+namespace sse {
+
+namespace {
+
+// set by the signal handler, checked by the accept loop
+volatile std::sig_atomic_t interrupted = 0;
+
+void on_signal(int) { interrupted = 1; }
+
+// a job is a short TOML document naming its files, not the files themselves
+constexpr std::size_t MAX_REQUEST = 1 << 20;
+// a client that stops sending without shutting down frees its worker after
+constexpr int RECEIVE_TIMEOUT = 30; // seconds
+
+/**
+ * @brief Write a whole buffer to a socket
+ * @return false if the client went away
+ */
+bool send_all(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    // no SIGPIPE if the client closed the connection
+    const auto n = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+bool send_all(int fd, const std::string &data) { return send_all(fd, data.data(), data.size()); }
+
+/**
+ * @brief One line of a reply, on a single line whatever the message
+ */
+std::string reply(const std::string &type, std::string message) {
+  std::replace(message.begin(), message.end(), '\n', ' ');
+  return type + " " + message + "\n";
+}
+
+/**
+ * @brief Sends the log messages of a job to its client, as progress lines
+ */
+class ProgressSink : public spdlog::sinks::base_sink<std::mutex> {
+public:
+  explicit ProgressSink(int fd) : fd(fd) {}
+
+protected:
+  void sink_it_(const spdlog::details::log_msg &msg) override {
+    send_all(fd, reply("progress", std::string(msg.payload.data(), msg.payload.size())));
+  }
+  void flush_() override {}
+
+private:
+  int fd;
+};
+
+} // namespace
+
+Daemon::Daemon(const std::filesystem::path &socket, unsigned workers) : path(socket) {
+  auto address = sockaddr_un();
+  address.sun_family = AF_UNIX;
+  if (path.string().size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Daemon: socket path too long: " + path.string());
+  }
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  // a socket left by a previous run would make bind() fail; anything else at
+  // the path is likely a mistake, and is left alone
+  const auto status = std::filesystem::symlink_status(path);
+  if (std::filesystem::is_socket(status)) {
+    std::filesystem::remove(path);
+  } else if (std::filesystem::exists(status)) {
+    throw std::runtime_error("Daemon: " + path.string() + " exists and isn't a socket");
+  }
+  listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    throw std::runtime_error(std::string("Daemon: socket: ") + std::strerror(errno));
+  }
+  if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+      ::listen(listener, SOMAXCONN) < 0) {
+    const auto error = std::string(std::strerror(errno));
+    ::close(listener);
+    throw std::runtime_error("Daemon: " + path.string() + ": " + error);
+  }
+  // identifies the socket bound here, not one replacing it meanwhile
+  struct stat created = {};
+  if (::stat(path.c_str(), &created) == 0) {
+    inode = created.st_ino;
+    device = created.st_dev;
+  }
+  // the workers, and the OCCT pool threads they start, inherit a mask blocking
+  // SIGINT and SIGTERM, so these are delivered to the thread waiting in accept()
+  sigset_t signals, previous;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+  for (unsigned i = 0; i < std::max(workers, 1u); ++i) {
+    this->workers.emplace_back([this]() { work(); });
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  spdlog::info("listening on {} with {} workers", path.string(), this->workers.size());
+}
+
+Daemon::~Daemon() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  ready.notify_all();
+  for (auto &w : workers) {
+    w.join();
+  }
+  // connections nobody served
+  while (!pending.empty()) {
+    ::close(pending.front());
+    pending.pop();
+  }
+  ::close(listener);
+  // only the socket this daemon created
+  struct stat current = {};
+  if (::lstat(path.c_str(), &current) == 0 && S_ISSOCK(current.st_mode) &&
+      current.st_ino == inode && current.st_dev == device) {
+    std::filesystem::remove(path);
+  }
+}
+
+void Daemon::run() {
+  // without SA_RESTART, so that accept() returns on a signal
+  struct sigaction action = {};
+  action.sa_handler = on_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  // a client going away fails the write instead of killing the daemon
+  std::signal(SIGPIPE, SIG_IGN);
+  while (!interrupted) {
+    const int connection = ::accept(listener, nullptr, nullptr);
+    if (connection < 0) {
+      if (errno != EINTR) {
+        spdlog::error("accept: {}", std::strerror(errno));
+      }
+      continue;
+    }
+    {
+      const std::lock_guard<std::mutex> lock(mutex);
+      pending.push(connection);
+    }
+    ready.notify_one();
+  }
+  spdlog::info("stopping");
+}
+
+void Daemon::work() {
+  while (true) {
+    int connection = -1;
+    {
+      auto lock = std::unique_lock<std::mutex>(mutex);
+      ready.wait(lock, [this]() { return stopping || !pending.empty(); });
+      if (stopping) {
+        return;
+      }
+      connection = pending.front();
+      pending.pop();
+    }
+    serve(connection);
+  }
+}
+
+void Daemon::serve(int connection) {
+  auto timeout = timeval();
+  timeout.tv_sec = RECEIVE_TIMEOUT;
+  ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  // the job is everything the client sends before shutting down its side
+  auto request = std::string();
+  char buffer[4096];
+  while (true) {
+    const auto n = ::recv(connection, buffer, sizeof(buffer), 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      const auto error = (errno == EAGAIN || errno == EWOULDBLOCK)
+                             ? std::string("timed out reading the job")
+                             : std::string(std::strerror(errno));
+      spdlog::error("receive: {}", error);
+      send_all(connection, reply("error", error));
+      ::close(connection);
+      return;
+    }
+    if (n == 0) {
+      break;
+    }
+    request.append(buffer, static_cast<std::size_t>(n));
+    if (request.size() > MAX_REQUEST) {
+      spdlog::error("receive: job larger than {} bytes", MAX_REQUEST);
+      send_all(connection,
+               reply("error", "job larger than " + std::to_string(MAX_REQUEST) + " bytes"));
+      ::close(connection);
+      return;
+    }
+  }
+
+  const auto id = ++jobs;
+  const auto logger = std::make_shared<spdlog::logger>(
+      "job " + std::to_string(id), std::make_shared<ProgressSink>(connection));
+  logger->set_level(spdlog::level::info);
+  try {
+    auto stream = std::istringstream(request);
+    auto job = Job(JobDescription::from_toml(toml::parse(stream, "job")), cache, logger);
+    spdlog::info("job {}: started", id);
+    const auto gcode = job.run();
+    std::size_t size = 0;
+    for (const auto &c : gcode) {
+      size += c.size();
+    }
+    send_all(connection, "gcode " + std::to_string(size) + "\n");
+    GCodeWriter::write(connection, gcode);
+    spdlog::info("job {}: done", id);
+  } catch (const std::exception &e) {
+    spdlog::error("job {}: {}", id, e.what());
+    send_all(connection, reply("error", e.what()));
+  }
+  ::close(connection);
+}
+
+} // namespace sse
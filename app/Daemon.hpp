@@ -0,0 +1,122 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Daemon.hpp
+ * @brief Long-running slicing service on a Unix domain socket
+ *
+ * This contains the prototypes for the Daemon class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <sse/ImportCache.hpp>
+
+namespace sse {
+
+/**
+ * @class Daemon
+ * @brief Slices the jobs sent to a Unix domain socket, on a pool of workers
+ * sharing an ImportCache, so repeated parts and profiles are read once and
+ * jobs don't pay the startup of the process.
+ *
+ * A client connects, sends a job as a TOML document (see
+ * JobDescription::from_toml) and shuts down its side of the connection. The
+ * daemon answers with lines of the form "progress <message>", then either
+ * "gcode <size>" followed by the size bytes of the program, or
+ * "error <message>", and closes the connection. Jobs larger than 1 MiB, or
+ * from a client silent for 30 seconds, are answered with an error.
+ */
+class Daemon {
+
+public:
+  /**
+   * @brief Listen on a socket
+   * @param socket Path of the socket; a stale one is replaced
+   * @param workers Number of jobs run concurrently
+   * @throws std::runtime_error if the socket can't be created, e.g. if
+   * something other than a socket exists at its path
+   */
+  Daemon(const std::filesystem::path &socket, unsigned workers);
+
+  /**
+   * @brief Stop the workers, then remove the socket, if it's still the one
+   * created by the daemon
+   */
+  ~Daemon();
+
+  Daemon(const Daemon &) = delete;
+  Daemon &operator=(const Daemon &) = delete;
+
+  /**
+   * @brief Accept connections until SIGINT or SIGTERM
+   *
+   * The workers block these signals, so they wake this thread; call it from
+   * the thread which constructed the daemon.
+   */
+  void run();
+
+private:
+  //! path of the socket
+  std::filesystem::path path;
+  //! listening socket
+  int listener{-1};
+  //! inode and device of the socket file, to remove only this one
+  ino_t inode{0};
+  dev_t device{0};
+  //! shapes and profiles shared by the jobs
+  ImportCache cache;
+  //! workers, each running one job at a time
+  std::vector<std::thread> workers;
+  //! accepted connections, waiting for a worker
+  std::queue<int> pending;
+  //! guards pending and stopping
+  std::mutex mutex;
+  //! signals a new connection, or stopping
+  std::condition_variable ready;
+  //! set to stop the workers
+  bool stopping{false};
+  //! number of jobs served, to name their loggers
+  std::atomic<unsigned> jobs{0};
+
+  /**
+   * @brief Run the jobs of the queue, until stopping
+   */
+  void work();
+
+  /**
+   * @brief Read a job from a connection, run it, and reply
+   * @param connection Connected socket, closed when done
+   */
+  void serve(int connection);
+};
+
+} // namespace sse
@@ -1,15 +1,29 @@
 #include <algorithm>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
-#include <sse/Importer.hpp>
-#include <sse/Object.hpp>
-#include <sse/slicer.hpp>
+#include <unistd.h>
+
+#include <sse/Batch.hpp>
+#include <sse/ImportCache.hpp>
+#include <sse/Job.hpp>
 #include <sse/version.hpp>
 
+#include <Message.hxx>
+#include <Message_Messenger.hxx>
+#include <Message_PrinterOStream.hxx>
+#include <OSD_Parallel.hxx>
+#include <OSD_ThreadPool.hxx>
+
 #include <cxxopts.hpp>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include "Daemon.hpp"
 
 namespace fs = std::filesystem;
 using namespace std;
@@ -21,13 +35,27 @@ using namespace std;
  * @return
  */
 int main(int argc, char **argv) {
+  // stdout carries the G-code: diagnostics, from spdlog and from the OCCT
+  // readers, go to stderr
+  spdlog::set_default_logger(spdlog::stderr_color_mt("sse"));
+  const auto &messenger = Message::DefaultMessenger();
+  messenger->RemovePrinters(STANDARD_TYPE(Message_PrinterOStream));
+  messenger->AddPrinter(new Message_PrinterOStream("cerr", false));
 
   // verbosity level
   int verbose = 0;
   double layerheight, linewidth = 0.0;
   string profile_filename;
   vector<string> files;
+  vector<int> extruders;
   bool autoplace = false;
+  bool autoorient = false;
+  bool spiral = false;
+  bool nonplanar = false;
+  string output_filename;
+  string socket_path;
+  string manifest;
+  unsigned workers = 2;
 
   cxxopts::Options opts(argv[0], " - Slice CAD files for 3D printing");
   opts.positional_help("[optional args]").show_positional_help();
@@ -53,11 +81,22 @@ int main(int argc, char **argv) {
 
       // placement group
       ("a,autoplace", "Automatically center/touch buildplate")
+      ("orient", "Automatically orient models to minimize supports")
+
+      // multi-material group
+      ("extruders", "Extruder of each file, in order, e.g. 1,2", cxxopts::value(extruders))
 
       // extrusion group
       ("l,layer_height", "Layer Height", cxxopts::value(layerheight))
       ("w,line_width", "Extrusion Width", cxxopts::value(linewidth))
       ("variable_layer", "Variable layer height", cxxopts::value<bool>())
+      ("spiral", "Spiral vase mode: one continuous toolpath along the outer wall")
+      ("nonplanar", "Slice with the tool surfaces set in the profile")
+
+      // service group
+      ("daemon", "Serve slicing jobs on a Unix domain socket", cxxopts::value(socket_path), "SOCKET")
+      ("batch", "Slice the jobs listed in a manifest, each to its own output", cxxopts::value(manifest), "MANIFEST")
+      ("workers", "Number of jobs sliced concurrently, in daemon and batch modes; they share the processor threads", cxxopts::value(workers))
 
       // positional, i.e. files to slice
       ("positional", "Positional arguments", cxxopts::value<vector<string>>());
@@ -85,16 +124,35 @@ int main(int argc, char **argv) {
       autoplace = true;
     }
 
+    // automatically rotate models into their best print orientation
+    if (result.count("orient")) {
+      autoorient = true;
+    }
+
+    // slice along a single helical surface
+    if (result.count("spiral")) {
+      spiral = true;
+    }
+
+    // slice along the configured (non-planar) tool surfaces
+    if (result.count("nonplanar")) {
+      nonplanar = true;
+    }
+
+    if (result.count("output")) {
+      output_filename = result["output"].as<string>();
+    }
+
     // load profile
     if (result.count("p")) {
-      cout << "profile: " << result["profile"].as<string>() << '\n';
+      cerr << "profile: " << result["profile"].as<string>() << '\n';
       profile_filename = fs::path(result["profile"].as<string>());
     }
 
     // positional args, i.e. files to slice
     if (result.count("positional")) {
       files = result["positional"].as<vector<string>>();
-    } else {
+    } else if (socket_path.empty() && manifest.empty()) {
       // no files to slice, error out
       cerr << "Error: no files provided\n";
     }
@@ -107,43 +165,82 @@ int main(int argc, char **argv) {
 
   // TODO: configurable log level
   // int loglevel = result.count("verbose");
-  auto s = sse::Slicer(profile_filename, spdlog::level::debug);
-
-  auto imp = sse::Importer{};
-  auto objects = vector<shared_ptr<sse::Object>>();
+  spdlog::set_level(spdlog::level::debug);
+
+  // concurrent jobs share the OCCT thread pool, which runs their parallel
+  // loops: size it so that the jobs and the pool use each processor thread once
+  if (!socket_path.empty() || !manifest.empty()) {
+    const auto threads = max(thread::hardware_concurrency(), 1u);
+    const auto jobs = max(workers, 1u);
+    OSD_Parallel::SetUseOcctThreads(true);
+    OSD_ThreadPool::DefaultPool()->Init(static_cast<int>(max(threads, jobs + 1) - jobs));
+  }
 
-  for (const auto &f : files) {
-    cout << "Loading file: " << f << '\n';
-    // check if file exists
-    if (!fs::exists(f)) {
-      cerr << "file " << f << " does not exist, skipping\n";
-      continue;
-    }
+  // serve jobs until interrupted
+  if (!socket_path.empty()) {
     try {
-      // import the object, then add it to the list
-      TopoDS_Shape s = imp.import(f.c_str());
-      objects.push_back(make_shared<sse::Object>(s));
-    } catch (std::runtime_error &e) {
+      auto daemon = sse::Daemon(socket_path, workers);
+      daemon.run();
+    } catch (const std::exception &e) {
       cerr << e.what() << endl;
-      continue;
+      return 1;
     }
-
+    return 0;
   }
 
-  // auto arrange objects
-  if (autoplace) {
-    s.arrange_objects(objects);
+  // slice every plate of the manifest, then summarize
+  if (!manifest.empty()) {
+    auto cache = sse::ImportCache();
+    auto results = vector<sse::Batch::Result>();
+    size_t num_files = 0;
+    try {
+      const auto batch = sse::Batch::from_file(manifest);
+      for (const auto &e : batch.get_entries()) {
+        num_files += e.description.files.size();
+      }
+      results = batch.run(cache, workers);
+    } catch (const std::exception &e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+    size_t failed = 0;
+    double total = 0;
+    cout << "job\tseconds\tstatus\toutput\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const auto &r = results[i];
+      cout << i + 1 << '\t' << fixed << setprecision(2) << r.seconds << '\t'
+           << (r.error.empty() ? "ok" : "failed: " + r.error) << '\t' << r.output.string() << '\n';
+      failed += r.error.empty() ? 0 : 1;
+      total += r.seconds;
+    }
+    cout << results.size() - failed << " of " << results.size() << " jobs sliced, "
+         << total << " job-seconds, " << cache.imports() << " imports for " << num_files
+         << " files\n";
+    return failed == 0 ? 0 : 1;
   }
-  // slice the objects
-  auto result = s.slice(objects);
-  // generate gcode
-  for (auto &slice : result) {
-    // print Z height
-    // cout << *slice << endl;
-    //
-    // slice->generate_shells(0,0);
-    //
-    // slice->generate_infill(0,0,0);
+
+  auto description = sse::JobDescription();
+  description.files = files;
+  description.extruders = extruders;
+  description.profile = profile_filename;
+  description.autoorient = autoorient;
+  description.autoplace = autoplace;
+  description.spiral = spiral;
+  description.nonplanar = nonplanar;
+
+  auto cache = sse::ImportCache();
+  try {
+    const auto gcode = sse::Job(description, cache, spdlog::default_logger()).run();
+    // write the program to the output file, or stdout
+    if (output_filename.empty()) {
+      cout.flush();
+      sse::GCodeWriter::write(STDOUT_FILENO, gcode);
+    } else {
+      sse::GCodeWriter::write(output_filename, gcode);
+    }
+  } catch (const std::exception &e) {
+    cerr << e.what() << endl;
+    return 1;
   }
 
   return 0;
@@ -0,0 +1,127 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Batch.hpp
+ * @brief Many slicing jobs from a manifest, run concurrently
+ *
+ * This contains the prototypes for the Batch class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <toml.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <sse/GCodeWriter.hpp>
+#include <sse/ImportCache.hpp>
+#include <sse/Job.hpp>
+
+namespace sse {
+
+/**
+ * @class Batch
+ * @brief A list of jobs, each writing its own program, e.g. the plates of an
+ * overnight run. Jobs run concurrently and share an ImportCache, so a part
+ * used by several plates is imported once.
+ *
+ * The manifest is a TOML file with an array of jobs, each a JobDescription
+ * table (see JobDescription::from_toml) plus its "output". Jobs without a
+ * profile use the top-level one. Relative paths are relative to the manifest.
+ * @code
+ * profile = "profile.toml"
+ * [[jobs]]
+ * files = ["bracket.step", "bracket.step"]
+ * output = "plate_1.gcode"
+ * autoplace = true
+ * @endcode
+ */
+class Batch {
+
+public:
+  /**
+   * @struct Entry
+   * @brief A job, and where its program goes
+   */
+  struct Entry {
+    //! what to slice
+    JobDescription description;
+    //! G-code file
+    fs::path output;
+  };
+
+  /**
+   * @struct Result
+   * @brief Outcome of a job
+   */
+  struct Result {
+    //! G-code file
+    fs::path output;
+    //! wall-clock time of the job, in seconds
+    double seconds{0};
+    //! error message, empty if the job succeeded
+    std::string error;
+  };
+
+  /**
+   * @brief Read a manifest
+   * @param manifest Manifest file
+   * @return Batch
+   * @throws std::runtime_error if the manifest or one of its jobs is invalid
+   */
+  static Batch from_file(const fs::path &manifest);
+
+  /**
+   * @brief Read a manifest
+   * @param table Parsed manifest
+   * @param base Directory relative paths are relative to
+   * @return Batch
+   * @throws std::runtime_error if a job is invalid
+   */
+  static Batch from_toml(const toml::value &table, const fs::path &base);
+
+  /**
+   * @brief Run the jobs; a failed job doesn't stop the others
+   * @param cache Shapes and profiles shared by the jobs
+   * @param threads Number of jobs run concurrently; their parallel loops share
+   * the OCCT default thread pool, sized by the caller
+   * @return Result of each job, in order
+   */
+  std::vector<Result> run(ImportCache &cache, unsigned threads) const;
+
+  /**
+   * @brief Return the jobs of the batch
+   */
+  const std::vector<Entry> &get_entries() const { return entries; }
+
+private:
+  //! jobs, in order
+  std::vector<Entry> entries;
+};
+
+} // namespace sse
@@ -0,0 +1,77 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file CompiledSettings.hpp
+ * @brief Print settings resolved for one object or region
+ *
+ * This contains the prototypes for the CompiledSettings struct
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <toml.hpp>
+
+#include <sse/Settings.hpp>
+
+namespace sse {
+
+/**
+ * @struct CompiledSettings
+ * @brief The print settings of an object or region, resolved once at slice
+ * time from layered sources: the global profile, then the object's
+ * overrides, then those of a modifier volume. The slicing stages read plain
+ * fields instead of looking up the TOML tree.
+ */
+struct CompiledSettings {
+  //! distance between layers
+  double layer_height{0.2};
+  //! section the object instead of splitting it
+  bool sectioning{false};
+  //! number of shells
+  int shells{3};
+  //! width of an extrusion, i.e. distance between shells
+  double extrusion_width{0.4};
+  //! sparse infill density, from 0 to 1
+  double infill_density{0.2};
+  //! solid layers below the top surfaces
+  int top_layers{3};
+  //! solid layers above the bottom surfaces
+  int bottom_layers{3};
+  //! maximum deviation of toolpaths from the exact geometry
+  double tolerance{0.01};
+
+  /**
+   * @brief Resolve the settings
+   * @param global Global profile
+   * @param overrides Tables of overrides, from the least to the most specific;
+   * null entries are skipped
+   * @return Settings
+   * @throws std::runtime_error if a setting is out of range
+   */
+  static CompiledSettings compile(const Settings &global,
+                                  const std::vector<const toml::value *> &overrides = {});
+};
+
+} // namespace sse
@@ -0,0 +1,225 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Contour.hpp
+ * @brief Planar toolpath contours, detached from the OCCT topology
+ *
+ * This contains the prototypes for the Contour class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <BRepAdaptor_Curve.hxx>
+#include <BRepTools_WireExplorer.hxx>
+#include <GCPnts_QuasiUniformDeflection.hxx>
+#include <GeomConvert.hxx>
+#include <GeomConvert_ApproxCurve.hxx>
+#include <GeomConvert_BSplineCurveToBezierCurve.hxx>
+#include <Geom_BSplineCurve.hxx>
+#include <Geom_BezierCurve.hxx>
+#include <Precision.hxx>
+#include <TopoDS_Edge.hxx>
+#include <TopoDS_Wire.hxx>
+#include <gp.hxx>
+#include <gp_Circ.hxx>
+#include <gp_XY.hxx>
+
+namespace sse {
+
+/**
+ * @class Contour
+ * @brief A planar path, made of line, arc and cubic Bezier segments.
+ *
+ * The vertices are stored in a contiguous array, along with the type of each
+ * segment and the center of each arc. Exact circular edges are kept as arcs,
+ * B-spline and Bezier edges as cubic Bezier segments (split at their knots,
+ * their degree raised or reduced to 3), every other curve is discretized to
+ * lines within a chord tolerance. A contour is built once per layer, after
+ * which shells, infill, supports and G-code generation don't need the OCCT
+ * topology anymore.
+ */
+class Contour {
+
+public:
+  /**
+   * @brief Type of a segment; arc directions are seen from +Z
+   */
+  enum class Segment : std::uint8_t { Line, ArcCW, ArcCCW, Cubic };
+
+  /**
+   * @struct Cubic
+   * @brief Inner control points of a cubic Bezier segment, whose outer control
+   * points are the start and end of the segment
+   */
+  struct Cubic {
+    //! control points 2 and 3
+    std::array<gp_XY, 2> controls;
+    //! weights of the 4 control points
+    std::array<double, 4> weights{1, 1, 1, 1};
+
+    /**
+     * @brief Whether the weights differ, i.e. the curve isn't polynomial
+     */
+    bool rational() const;
+  };
+
+  /**
+   * @brief Build a contour from a planar wire, parallel to the XY plane
+   * @param wire Wire to convert
+   * @param tolerance Maximum distance between the lines and the exact curves
+   * @return Contour following the wire
+   */
+  static Contour from_wire(const TopoDS_Wire &wire, double tolerance);
+
+  /**
+   * @brief Start the contour
+   * @param p First point
+   */
+  void move_to(const gp_XY &p);
+
+  /**
+   * @brief Add a line segment
+   * @param p End point
+   */
+  void line_to(const gp_XY &p);
+
+  /**
+   * @brief Add an arc segment, of at most half a turn
+   * @param p End point
+   * @param center Center of the arc
+   * @param ccw Whether the arc is counterclockwise, seen from +Z
+   */
+  void arc_to(const gp_XY &p, const gp_XY &center, bool ccw);
+
+  /**
+   * @brief Add a cubic Bezier segment
+   * @param p End point
+   * @param c Inner control points and weights
+   */
+  void cubic_to(const gp_XY &p, const Cubic &c);
+
+  /**
+   * @brief Reverse the direction of the contour
+   */
+  void reverse();
+
+  /**
+   * @brief Start a closed contour on another of its vertices, e.g. to move
+   * its seam; the path itself is unchanged
+   * @param vertex Index of the new first point
+   */
+  void rotate(std::size_t vertex);
+
+  /**
+   * @brief Control points of a cubic segment
+   * @param i Segment index
+   */
+  const Cubic &cubic(std::size_t i) const { return cubics[indices[i]]; }
+
+  /**
+   * @brief Evaluate a cubic segment
+   * @param i Segment index
+   * @param t Parameter, in [0, 1]
+   */
+  gp_XY evaluate(std::size_t i, double t) const;
+
+  /**
+   * @brief Number of segments
+   */
+  std::size_t size() const { return segments.size(); }
+
+  /**
+   * @brief Whether the contour has no segments
+   */
+  bool empty() const { return segments.empty(); }
+
+  /**
+   * @brief Whether the contour ends on its first point
+   */
+  bool closed() const {
+    return size() > 1 && points.front().IsEqual(points.back(), Precision::Confusion());
+  }
+
+  /**
+   * @brief Start point of a segment
+   */
+  const gp_XY &start(std::size_t i) const { return points[i]; }
+
+  /**
+   * @brief End point of a segment
+   */
+  const gp_XY &end(std::size_t i) const { return points[i + 1]; }
+
+  /**
+   * @brief Signed sweep angle of an arc segment, positive counterclockwise
+   * @param i Segment index
+   */
+  double sweep(std::size_t i) const;
+
+  /**
+   * @brief Length of a segment
+   * @param i Segment index
+   */
+  double length(std::size_t i) const;
+
+  /**
+   * @brief Total length of the contour
+   */
+  double length() const;
+
+  /**
+   * @brief Discretize a segment, arcs and cubics within a chord tolerance.
+   * Arcs are split uniformly, cubics adaptively, with the fewest points
+   * needed to meet the tolerance.
+   * @param i Segment index
+   * @param tolerance Maximum distance between the lines and the arc
+   * @param out Points after the start of the segment, up to its end included
+   */
+  void flatten(std::size_t i, double tolerance, std::vector<gp_XY> &out) const;
+
+  /**
+   * @brief Discretize the whole contour, arcs within a chord tolerance
+   * @param tolerance Maximum distance between the lines and the arcs
+   * @return Polyline, starting with the first point
+   */
+  std::vector<gp_XY> flatten(double tolerance) const;
+
+  //! height of the contour
+  double z{0};
+  //! vertices; segment i goes from points[i] to points[i + 1]
+  std::vector<gp_XY> points;
+  //! type of each segment
+  std::vector<Segment> segments;
+  //! center of each segment, only meaningful for arcs
+  std::vector<gp_XY> centers;
+  //! index of each segment in cubics, only meaningful for cubics
+  std::vector<std::uint32_t> indices;
+  //! control points of the cubic segments
+  std::vector<Cubic> cubics;
+};
+
+} // namespace sse
@@ -19,7 +19,13 @@
 #pragma once
 
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include <TopExp.hxx>
 #include <TopExp_Explorer.hxx>
@@ -35,6 +41,10 @@
 #include <BRepTools_WireExplorer.hxx>
 #include <BRep_Tool.hxx>
 #include <BRepAdaptor_Curve.hxx>
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <BRepBuilderAPI_MakeWire.hxx>
+#include <GCPnts_QuasiUniformDeflection.hxx>
+#include <Precision.hxx>
 #include <Standard_Real.hxx>
 
 #include <Geom_BSplineCurve.hxx>
@@ -55,8 +65,12 @@
 #include <gp_Lin.hxx>
 #include <gp_Circ.hxx>
 #include <gp_Parab.hxx>
+#include <gp_XY.hxx>
+#include <gp_XYZ.hxx>
 
+#include <sse/Contour.hpp>
 #include <sse/Settings.hpp>
+#include <sse/TravelPlanner.hpp>
 
 // start off with a buffer size of 1MB
 #define INITIAL_GCODE_SIZE 1048576
@@ -66,10 +80,59 @@ namespace sse {
 class GCodeWriter{
 
 public:
-    GCodeWriter();
+    /**
+     * @struct State
+     * @brief The machine state a program depends on, e.g. to render a layer
+     * on its own, starting where the previous one ends
+     */
+    struct State {
+      //! position of the tool
+      gp_XYZ position{0, 0, 0};
+      //! current extruder, from 1
+      int extruder{1};
+      //! filament retracted in each idle extruder
+      std::map<int, double> retracted;
+    };
+
+    /**
+     * @brief GCodeWriter constructor, for a whole program
+     * @param settings Settings of the job; must outlive the writer
+     */
+    explicit GCodeWriter(const Settings &settings);
 
     /**
-     * @brief Create the comment header for the program
+     * @brief GCodeWriter constructor, for part of a program, e.g. a layer
+     * @param settings Settings of the job; must outlive the writer
+     * @param state State of the machine before the first move
+     */
+    GCodeWriter(const Settings &settings, const State &state);
+
+    /**
+     * @brief Get the state of the machine after the last move
+     */
+    State get_state() const;
+
+    /**
+     * @brief Write a program made of chunks, e.g. one per layer, in order,
+     * with vectored I/O instead of concatenating them first
+     * @param fd File descriptor, left open
+     * @param chunks Program
+     * @throws std::runtime_error if writing fails
+     */
+    static void write(int fd, const std::vector<std::string> &chunks);
+
+    /**
+     * @brief Write a program made of chunks to a file, replacing it
+     * @param file Output file
+     * @param chunks Program
+     * @throws std::runtime_error if writing fails
+     */
+    static void write(const std::filesystem::path &file, const std::vector<std::string> &chunks);
+
+    /**
+     * @brief Create the header of the program: a comment describing the job,
+     * then the modes the moves rely on (millimeters, absolute positions,
+     * relative extrusion)
      */
     void create_header();
 
@@ -77,7 +140,7 @@ public:
      * @brief Add a comment line to the program
      * @param comment
      */
-    inline void add_comment(const std::string &comment) {data.append(";" + comment);}
+    inline void add_comment(const std::string &comment) {data.append(";" + comment + "\n");}
 
     /**
      * @brief Add a rapid move to the program
@@ -89,37 +152,211 @@ public:
     std::string add_rapid(gp_Pnt destination);
 
     /**
-     * @brief Add a linear move to the program
-     * @param c
+     * @brief Add an arc move (G2/G3) in the XY plane, from the current position
+     * @param end End point
+     * @param center Center of the arc
+     * @param ccw Whether the arc is counterclockwise (G3), seen from +Z
+     * @param length Length of the arc, i.e. the extrusion
+     * @param feedrate Feedrate, mm/min
+     * @return The move
      */
-    std::string add_line(Geom_Line l);
-    std::string add_line(Handle(Geom_Line) l);
-    std::string add_line(gp_Lin l);
+    std::string add_arc(const gp_XY &end, const gp_XY &center, bool ccw,
+                        double length, double feedrate);
 
     /**
-     * @brief Generate a valid arc move for the program
-     * @param c
+     * @brief Add a cubic Bezier move (G5), from the current position
+     * @param end End point
+     * @param c Inner control points, the weights are ignored
+     * @param length Length of the curve, i.e. the extrusion
+     * @param feedrate Feedrate, mm/min
+     * @return The move
      */
-    std::string add_arc(Handle(Geom_Circle) c);
+    std::string add_bezier(const gp_XY &end, const Contour::Cubic &c,
+                           double length, double feedrate);
 
-    void add_bezier(Geom_BezierCurve b);
+    /**
+     * @brief Add a cubic NURBS block (G5.2 ... G5.3), from the current position
+     * @param end End point
+     * @param c Inner control points and weights
+     * @param length Length of the curve, i.e. the extrusion
+     * @param feedrate Feedrate, mm/min
+     * @return The block
+     */
+    std::string add_nurbs(const gp_XY &end, const Contour::Cubic &c,
+                          double length, double feedrate);
 
-    void add_bslpine(Geom_BSplineCurve b);
+    /**
+     * @brief Add a planar edge, within its bounds and in its orientation, as
+     * lines, arcs or spline moves depending on the settings, like add_wire()
+     * @param e Edge
+     * @return The moves
+     */
+    std::string add_edge(const TopoDS_Edge &e);
 
-    void add_nurbs();
+    /**
+     * @brief Add a planar B-spline or Bezier curve, see add_edge()
+     * @param c Curve
+     * @return The moves
+     */
+    std::string add_bspline(Handle(Geom_BoundedCurve) c);
 
-    std::string add_segment(GeomAdaptor_Curve c);
+    /**
+     * @brief Add a planar curve, e.g. from BRep_Tool::Curve(), see add_edge()
+     * @param c Curve: bounded, e.g. trimmed, or closed, e.g. a full circle
+     * @return The moves
+     * @throws std::runtime_error if the curve is unbounded, e.g. a line
+     */
     std::string add_segment(Handle(Geom_Curve) c);
-    std::string add_segment(Geom_TrimmedCurve c);
 
     void add_wire(TopoDS_Wire w);
+
+    /**
+     * @brief Add a toolpath, following the wire with linear moves. Z follows
+     * the path, e.g. along a non-planar layer. Moves shorter than the
+     * "min_segment_length" setting are merged, within the tolerance.
+     * @param w Wire to follow
+     * @param tolerance Maximum distance between the moves and the wire
+     */
+    void add_path(const TopoDS_Wire &w, double tolerance);
+
+    /**
+     * @brief Add a planar contour: a rapid move to its start, then its segments.
+     * Segments without a native move are flattened within the tolerance, and
+     * linear moves shorter than the "min_segment_length" setting are merged,
+     * so short lines don't overrun the move queue of the controller, as long
+     * as the merged move stays within the tolerance.
+     * @param c Contour to follow
+     * @param tolerance Maximum distance between the moves and the arcs
+     */
+    void add_contour(const Contour &c, double tolerance);
+    /**
+     * @brief Retract the filament
+     * @param distance Length of filament
+     */
     void retract(double distance);
+
+    /**
+     * @brief Prime the filament after a retraction
+     * @param distance Length of filament
+     */
+    void unretract(double distance);
+
+    /**
+     * @brief Switch to another extruder (T<n - 1>), retracting the current
+     * one; the moves then use the printer.extruder_<n> settings
+     * @param n Extruder number, from 1
+     */
+    void set_extruder(int n);
+
+    /**
+     * @brief Get the current extruder
+     * @return Extruder number, from 1
+     */
+    inline int get_extruder() const { return extruder; }
+
+    /**
+     * @brief Travel to a point: inside the region of the travel planner if
+     * possible, otherwise with a retraction
+     * @param p Destination
+     */
+    void travel_to(const gp_XYZ &p);
+
+    /**
+     * @brief Set the travel planner of the current layer
+     * @param p Planner, nullptr to always retract; must outlive its use
+     */
+    inline void set_travel_planner(const TravelPlanner *p) { planner = p; }
     void purge();
     inline std::string get_data() {return this->data;}
+
+    /**
+     * @brief Move the program out of the writer, without copying it
+     * @return Program; the writer is left empty
+     */
+    inline std::string take_data() { return std::move(data); }
+
+    /**
+     * @brief Reset the E axis (G92 E0), e.g. at the start of a layer, so a
+     * layer doesn't depend on the extrusion before it
+     */
+    inline void reset_extrusion() { data.append("G92 E0\n"); }
 private:
     std::map<double,std::vector<std::string>> data_map;
     std::string data;
-    sse::Settings &config;
+    const sse::Settings &config;
+    //! current position of the tool
+    gp_XYZ position{0, 0, 0};
+    //! current extruder, from 1
+    int extruder{1};
+    //! filament retracted in each idle extruder
+    std::map<int, double> retracted;
+
+    /**
+     * @struct Options
+     * @brief Settings of the moves, resolved once per writer so the moves
+     * don't look up the profile
+     */
+    struct Options {
+      //! maximum distance between the moves and the exact geometry
+      double tolerance{0.01};
+      //! minimum length of a linear move
+      double min_segment_length{0};
+      //! emit arcs as G2/G3 moves
+      bool arc_moves{true};
+      //! spline moves: none, G5 (Bezier) or G5.2 (NURBS)
+      enum class Splines { None, Bezier, Nurbs } splines{Splines::None};
+    };
+
+    /**
+     * @struct ExtruderSettings
+     * @brief Settings of one extruder, from its printer.extruder_<n> table,
+     * resolved when it's selected
+     */
+    struct ExtruderSettings {
+      //! feedrate of extruding moves, mm/min
+      double feedrate{3600};
+      //! feedrate of retractions, mm/min, 0 to use the last one
+      double retraction_feedrate{0};
+      //! filament retracted for travel moves and while idle
+      double retraction{0};
+    };
+
+    //! settings of the moves
+    Options options;
+    //! settings of the current extruder
+    ExtruderSettings tool;
+
+    /**
+     * @brief Resolve the settings of the moves
+     */
+    Options compile_options() const;
+
+    /**
+     * @brief Resolve the settings of an extruder
+     * @param n Extruder number, from 1
+     */
+    ExtruderSettings compile_extruder(int n) const;
+
+    //! routes travel moves inside the current layer
+    const TravelPlanner *planner{nullptr};
+    //! skipped points of the current linear move, see min_segment_length
+    std::vector<gp_XYZ> skipped;
+
+    /**
+     * @brief Linear move, merged with the next one if shorter than min_length,
+     * as long as the merged points stay within the tolerance of the move
+     * @param p End point
+     * @param feedrate Feedrate, mm/min
+     * @param min_length Minimum length of a move
+     * @param tolerance Maximum distance between a merged point and the move
+     */
+    void line_to(const gp_XYZ &p, double feedrate, double min_length, double tolerance);
+
+    /**
+     * @brief Emit the last skipped point of the current linear move, if any
+     * @param feedrate Feedrate, mm/min
+     */
+    void flush(double feedrate);
     void move_pre(GeomAdaptor_Curve c);
 };
 
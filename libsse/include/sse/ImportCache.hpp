@@ -0,0 +1,140 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ImportCache.hpp
+ * @brief Imported shapes and parsed profiles, shared between jobs
+ *
+ * This contains the prototypes for the ImportCache class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <BRepBuilderAPI_Copy.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include <sse/Importer.hpp>
+#include <sse/Settings.hpp>
+
+namespace sse {
+
+/**
+ * @class ImportCache
+ * @brief Imports each file and parses each profile once, for all the jobs of
+ * a process, e.g. the plates of a batch sharing parts, or the jobs of a
+ * daemon. Entries are keyed by path and modification time, so an edited file
+ * is read again, and replaces the entry of its previous version. Jobs asking
+ * for a file that is being imported wait for it instead of importing it again.
+ * The cache keeps a bounded number of shapes and of profiles, forgetting the
+ * least recently used ones, so a long-running daemon doesn't grow forever.
+ */
+class ImportCache {
+
+public:
+  /**
+   * @brief Create an empty cache
+   * @param capacity Number of shapes, and of profiles, kept
+   */
+  explicit ImportCache(std::size_t capacity = 64) : capacity(std::max<std::size_t>(capacity, 1)) {}
+
+  /**
+   * @brief Import a file, or reuse the shape imported before
+   * @param file File to import
+   * @return Copy of the shape, which the job can transform and mesh
+   * @throws std::runtime_error if the file doesn't exist or the import fails
+   */
+  TopoDS_Shape shape(const std::string &file);
+
+  /**
+   * @brief Parse a profile, or reuse the settings parsed before
+   * @param profile Profile to parse
+   * @return Copy of the settings, which the job can override
+   * @throws std::runtime_error if the file doesn't exist
+   */
+  Settings settings(const fs::path &profile);
+
+  /**
+   * @brief Number of files imported, i.e. not found in the cache
+   */
+  std::size_t imports() const;
+
+  /**
+   * @brief Number of shapes and profiles held
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Forget all the entries
+   */
+  void clear();
+
+private:
+  //! canonical path and modification time of a file
+  using Key = std::pair<std::string, fs::file_time_type>;
+
+  //! a shape or profile, loaded or being loaded
+  template <typename T> struct Entry {
+    std::shared_future<T> value;
+    //! tick of the last lookup
+    std::size_t used{0};
+  };
+
+  //! guards the maps, not the entries
+  mutable std::mutex mutex;
+  //! imported shapes
+  std::map<Key, Entry<TopoDS_Shape>> shapes;
+  //! parsed profiles
+  std::map<Key, Entry<Settings>> profiles;
+  //! maximum number of entries of each map
+  std::size_t capacity;
+  //! lookups so far, to order the entries by use
+  std::size_t tick{0};
+  //! number of imports
+  std::size_t count{0};
+
+  /**
+   * @brief Identify a file
+   * @throws std::runtime_error if it doesn't exist
+   */
+  static Key key(const fs::path &file);
+
+  /**
+   * @brief Find an entry, or load it if no job has yet; failed loads are
+   * forgotten, so that they can be retried
+   */
+  template <typename T, typename F>
+  T lookup(std::map<Key, Entry<T>> &cache, const Key &key, F load);
+
+  /**
+   * @brief Make room for a new entry: forget the older versions of its file,
+   * then the least recently used entries beyond the capacity
+   */
+  template <typename T> void evict(std::map<Key, Entry<T>> &cache, const Key &key);
+};
+
+} // namespace sse
@@ -0,0 +1,120 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Job.hpp
+ * @brief A slicing job: files, profile and options, to a G-code program
+ *
+ * This contains the prototypes for the Job class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <toml.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <sse/ImportCache.hpp>
+#include <sse/Object.hpp>
+#include <sse/Settings.hpp>
+#include <sse/slicer.hpp>
+
+namespace sse {
+
+/**
+ * @struct JobDescription
+ * @brief What to slice, and how
+ */
+struct JobDescription {
+  //! files to slice
+  std::vector<std::string> files;
+  //! extruder of each file, in order; the others use the first extruder
+  std::vector<int> extruders;
+  //! settings profile
+  fs::path profile;
+  //! settings overriding the profile
+  toml::value overrides{toml::table{}};
+  //! rotate the objects into their best print orientation
+  bool autoorient{false};
+  //! arrange the objects on the build plate
+  bool autoplace{false};
+  //! spiral (vase) mode
+  bool spiral{false};
+  //! slice with the tool surfaces set in the profile
+  bool nonplanar{false};
+
+  /**
+   * @brief Read a job from a table, e.g.
+   * @code
+   * profile = "profile.toml"
+   * files = ["a.step", "b.step"]
+   * extruders = [1, 2]
+   * autoplace = true
+   * [overrides]
+   * layer_height = 0.2
+   * @endcode
+   * @param table Job table
+   * @return Job description
+   * @throws std::runtime_error if the files or the profile are missing
+   */
+  static JobDescription from_toml(const toml::value &table);
+};
+
+/**
+ * @class Job
+ * @brief Runs a job description through the slicer. Jobs are independent, so
+ * a process can run several concurrently, sharing an ImportCache.
+ */
+class Job {
+
+public:
+  /**
+   * @brief Job constructor
+   * @param description What to slice
+   * @param cache Shapes and profiles shared with other jobs; must outlive the
+   * job
+   * @param logger Logger of the job
+   */
+  Job(JobDescription description, ImportCache &cache,
+      std::shared_ptr<spdlog::logger> logger);
+
+  /**
+   * @brief Slice the files
+   * @return G-code program, in chunks, e.g. one per layer; see
+   * GCodeWriter::write()
+   * @throws std::runtime_error if any file, or any of its modifiers, can't be
+   * loaded, or slicing fails
+   */
+  std::vector<std::string> run();
+
+private:
+  //! what to slice
+  JobDescription description;
+  //! shapes and profiles shared with other jobs
+  ImportCache &cache;
+  //! logger of the job
+  std::shared_ptr<spdlog::logger> logger;
+};
+
+} // namespace sse
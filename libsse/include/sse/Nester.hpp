@@ -0,0 +1,211 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Nester.hpp
+ * @brief Nests objects on the build plate, based on their real outline
+ *
+ * This contains the prototypes for the Nester class
+ *
+ * @author Karl Nilsson
+ * @bug outlines are conservative, i.e. rounded up to the raster resolution
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <OSD_Parallel.hxx>
+#include <Precision.hxx>
+#include <Standard_Real.hxx>
+#include <gp_Ax1.hxx>
+#include <gp_XY.hxx>
+
+#include <sse/Object.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace sse {
+
+/**
+ * @class Nester
+ * @brief Nest objects on the build plate, based on their projected outline.
+ *
+ * The silhouette of each object (its mesh, projected onto the XY plane) is
+ * rasterized onto a grid, then expanded by half the spacing between objects.
+ * Objects are placed biggest first, in all four 90° orientations, at the
+ * bottom-left-most position where the raster doesn't collide with already
+ * placed objects. Candidate positions are evaluated in parallel, one task per
+ * raster row.
+ *
+ * Unlike the Packer, concave objects (e.g. L-shapes) can interlock, and round
+ * objects don't waste the corners of their bounding box.
+ *
+ * Circular build plates are supported: cells outside the circle are marked as
+ * occupied, and objects are placed in rings around the center of the plate,
+ * i.e. as close to the center as possible, instead of bottom-left.
+ */
+class Nester {
+
+public:
+  /**
+   * @brief Nester constructor
+   * @param objects List of objects to nest
+   * @param plate_x Build plate X dimension
+   * @param plate_y Build plate Y dimension
+   * @param spacing Minimum distance between objects
+   * @param resolution Raster cell size
+   * @param circular Whether the build plate is a circle, inscribed in the
+   * plate dimensions
+   * @throws std::runtime_error Thrown if the parameters are invalid
+   */
+  Nester(std::vector<std::shared_ptr<Object>> objects, double plate_x,
+         double plate_y, double spacing = 5.0, double resolution = 1.0,
+         bool circular = false);
+
+  /**
+   * @brief Find a position for every object on the build plate
+   * @throws std::runtime_error Thrown if an object doesn't fit on the plate
+   */
+  void nest();
+
+  /**
+   * @brief Move all objects to their new position on the buildplate
+   */
+  void arrange() const;
+
+private:
+  /**
+   * @struct Footprint
+   * @brief Rasterized outline of an object, in one orientation
+   *
+   * The raster is stored as a list of horizontal spans of occupied cells, which
+   * is all that's needed for collision checks.
+   */
+  struct Footprint {
+    //! rotation about Z, in multiples of 90°
+    int quarter_turns{0};
+    //! center of rotation
+    gp_XY center;
+    //! world XY coordinate of raster cell (0,0), after rotation
+    gp_XY origin;
+    //! raster width, in cells
+    int width{0};
+    //! raster length, in cells
+    int length{0};
+    //! number of occupied cells
+    std::size_t area{0};
+    //! occupied spans: row, first column, one-past-last column
+    std::vector<std::array<int, 3>> spans;
+  };
+
+  /**
+   * @struct Placement
+   * @brief Final position of an object on the plate
+   */
+  struct Placement {
+    //! object to move
+    Object *object{nullptr};
+    //! orientation of the object
+    const Footprint *footprint{nullptr};
+    //! X position, in cells
+    int x{0};
+    //! Y position, in cells
+    int y{0};
+  };
+
+  /**
+   * @brief Rasterize the silhouette of an object, rotated about its center
+   * @param triangles Mesh of the object
+   * @param center Center of rotation
+   * @param quarter_turns Rotation about Z, in multiples of 90°
+   * @return Rasterized footprint
+   */
+  Footprint rasterize(const std::vector<std::array<gp_Pnt, 3>> &triangles,
+                      const gp_XY &center, int quarter_turns) const;
+
+  /**
+   * @brief Check whether a footprint collides with the plate at a position
+   * @param f Target footprint
+   * @param x X position, in cells
+   * @param y Y position, in cells
+   * @return Whether the footprint fits
+   */
+  bool fits(const Footprint &f, int x, int y) const;
+
+  /**
+   * @brief Cost of a footprint position, lower is better
+   *
+   * Rectangular plates: extent of the nest (top, then right edge).
+   * Circular plates: distance of the footprint center from the plate center.
+   */
+  double cost(const Footprint &f, int x, int y) const;
+
+  /**
+   * @brief Search the plate for the best position of a footprint
+   * @param f Target footprint
+   * @return (x,y) position in cells, or (-1,-1) if it doesn't fit anywhere
+   */
+  std::pair<int, int> search(const Footprint &f) const;
+
+  /**
+   * @brief Mark the cells of a footprint as occupied
+   * @param f Target footprint
+   * @param x X position, in cells
+   * @param y Y position, in cells
+   */
+  void occupy(const Footprint &f, int x, int y);
+
+  /**
+   * @brief Number of occupied cells in [begin, end) of a plate row
+   */
+  inline int occupied(int row, int begin, int end) const {
+    const auto *r = &prefix[static_cast<std::size_t>(row) * (plate_width + 1)];
+    return r[end] - r[begin];
+  }
+
+  //! list of objects to nest
+  std::vector<std::shared_ptr<Object>> objects;
+  //! candidate footprints, four per object
+  std::vector<std::array<Footprint, 4>> footprints;
+  //! resulting placements
+  std::vector<Placement> placements;
+  //! plate width, in cells
+  int plate_width;
+  //! plate length, in cells
+  int plate_length;
+  //! minimum distance between objects
+  double spacing;
+  //! raster cell size
+  double resolution;
+  //! whether the build plate is circular
+  bool circular;
+  //! plate occupancy
+  std::vector<std::uint8_t> plate;
+  //! per-row prefix sums of the plate occupancy
+  std::vector<int> prefix;
+};
+
+} // namespace sse
@@ -24,9 +24,15 @@
 #include <BRepBuilderAPI_MakeFace.hxx>
 #include <BRepBuilderAPI_Transform.hxx>
 #include <BRepGProp.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
 #include <BRepTools.hxx>
 #include <BRep_Tool.hxx>
 #include <GProp_GProps.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Precision.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS.hxx>
 
 #include <BndLib.hxx>
 #include <Bnd_Box.hxx>
@@ -46,29 +52,58 @@
 #include <Standard_Handle.hxx>
 #include <StdFail_NotDone.hxx>
 
+#include <array>
 #include <math.h>
 #include <memory>
 #include <iostream>
+#include <optional>
+#include <vector>
 
 #include <spdlog/spdlog.h>
+#include <toml.hpp>
 
 namespace sse {
 
+/**
+ * @brief Bounding box precision
+ */
+enum class BoundsPrecision {
+  //! BRepBndLib::Add: cheap, but may be loose around curved geometry
+  Fast,
+  //! BRepBndLib::AddOptimal: tight, but costly for complex shapes
+  Optimal
+};
+
 /**
  * @brief The Object class
  */
 class Object {
 
 public:
+  /**
+   * @struct Modifier
+   * @brief A volume whose settings override those of the object, for the
+   * regions of the object inside it
+   */
+  struct Modifier {
+    //! volume, in the coordinates of the object's file
+    TopoDS_Shape volume;
+    //! settings of the regions inside the volume
+    toml::value overrides;
+  };
 
   /**
    * @brief Object constructor
    * @param s Underlying shape
    */
-  explicit Object(TopoDS_Shape &shape, const std::string &fname = "");
+  explicit Object(const TopoDS_Shape &shape, const std::string &fname = "");
 
   /**
    * @brief Generate the bounding box
+   *
+   * The bounds of the geometry are cached, and only recomputed if the shape
+   * changed, or if the rigid motions since the last computation made the cached
+   * bounds inexact (i.e. rotations other than quarter turns).
    * @param optimal Flag to generate optimal bounding box
    * @param gap Increase bounding box by $gap in each direction
    */
@@ -155,14 +190,38 @@ public:
    */
   void scale(const double x, const double y, const double z);
 
+  /**
+   * @brief Transform the object
+   *
+   * The transformation is accumulated, and only applied to the underlying
+   * shape once the geometry is needed, i.e. get_shape(). The bounding box is
+   * updated immediately, without looking at the geometry.
+   * @param transform Transformation to apply after any pending ones
+   */
   void transform(const gp_Trsf transform);
 
   /**
    * @brief Get the bounding box, aligned to the cartesian axes
-   * @return bounding box
+   * @return bounding box, as precise as the last computation
    */
   const Bnd_Box &get_bound_box() const { return this->bounding_box; }
 
+  /**
+   * @brief Get the bounding box, refining it first if necessary
+   *
+   * Objects start out with fast bounds; callers that need tight bounds, e.g.
+   * packing or build plate overflow checks, request them here. The refinement
+   * is cached, so it only costs once per geometry version.
+   * @param precision Minimum precision of the bounding box
+   * @return bounding box
+   */
+  const Bnd_Box &get_bound_box(BoundsPrecision precision) {
+    if (precision == BoundsPrecision::Optimal) {
+      generate_bounds(true, bounding_box.GetGap());
+    }
+    return this->bounding_box;
+  }
+
   /**
    * @brief Get the bottom rectangle of the bounding box
    * @return
@@ -206,16 +265,88 @@ public:
   const gp_Pnt center_point() const;
 
   /**
-   * @brief get_volume
-   * @return
+   * @brief Get the volume, cached until the shape changes
+   * @return volume
    */
   double get_volume() const;
 
   /**
-   * @brief get_shape
-   * @return
+   * @brief Get the center of mass, cached until the shape changes
+   * @return center of mass
+   */
+  gp_Pnt center_of_mass() const;
+
+  /**
+   * @brief Replace the underlying shape, invalidating all cached properties
+   * @param s New shape
+   */
+  void set_shape(const TopoDS_Shape &s);
+
+  /**
+   * @brief Get the version of the geometry, which changes whenever the shape
+   * is replaced. Transformations don't change the version.
+   * @return version
+   */
+  std::size_t get_version() const { return version; }
+
+  /**
+   * @brief Get the extruder that prints the object
+   * @return extruder number, from 1, i.e. the printer.extruder_<n> settings
+   */
+  int get_extruder() const { return extruder; }
+
+  /**
+   * @brief Assign the object to an extruder
+   * @param n Extruder number, from 1
+   */
+  void set_extruder(int n) { extruder = n; }
+
+  /**
+   * @brief Get the file the object was loaded from
+   * @return file name, empty if unknown
+   */
+  const std::string &get_filename() const { return filename; }
+
+  /**
+   * @brief Get the settings overriding the global ones for this object
+   * @return table of settings, empty if there are none
+   */
+  const toml::value &get_overrides() const { return overrides; }
+
+  /**
+   * @brief Override global settings for this object
+   * @param table Table of settings, with the same names as the global ones
+   */
+  void set_overrides(const toml::value &table) { overrides = table; }
+
+  /**
+   * @brief Add a modifier volume, which moves along with the object
+   * @param volume Solid, in the coordinates the object was loaded in
+   * @param table Settings of the regions inside the volume
+   */
+  void add_modifier(const TopoDS_Shape &volume, const toml::value &table);
+
+  /**
+   * @brief Get the modifier volumes, in their current position
+   * @return modifiers, in the order they were added
+   */
+  std::vector<Modifier> get_modifiers() const;
+
+  /**
+   * @brief Triangulate the object, e.g. to get its silhouette
+   * @param deflection Maximum linear deflection of the mesh
+   * @return List of triangles, in world coordinates, oriented outwards
+   */
+  std::vector<std::array<gp_Pnt, 3>> triangulate(double deflection) const;
+
+  /**
+   * @brief Get the underlying shape, with all pending transformations applied
+   * @return shape
    */
-  inline TopoDS_Shape &get_shape() { return *shape; }
+  inline TopoDS_Shape &get_shape() {
+    apply_transform();
+    return *shape;
+  }
 
   friend std::ostream& operator<<(std::ostream& out, Object& o){
     // DumpJson only in occt-7.4
@@ -224,7 +355,70 @@ public:
   }
 
 private:
-  std::unique_ptr<TopoDS_Shape> shape;
+  /**
+   * @brief Apply the accumulated transformation to the underlying shape
+   */
+  void apply_transform() const;
+
+  /**
+   * @brief Regenerate the footprint from the bounding box
+   */
+  void update_footprint();
+
+  /**
+   * @brief Compute (if necessary) and cache the mass properties
+   */
+  void update_mass() const;
+
+  /**
+   * @struct MassProperties
+   * @brief Cached mass properties, in the current position of the object
+   */
+  struct MassProperties {
+    //! geometry version the properties were computed for
+    std::size_t version;
+    //! volume
+    double volume;
+    //! center of mass
+    gp_Pnt center;
+  };
+
+  /**
+   * @struct Bounds
+   * @brief Cached bounds of the geometry, without gap
+   */
+  struct Bounds {
+    //! geometry version the bounds were computed for
+    std::size_t version;
+    //! whether the bounds were computed with BRepBndLib::AddOptimal
+    bool optimal;
+    //! bounds at the time of computation
+    Bnd_Box box;
+    //! transformations since the bounds were computed
+    gp_Trsf trsf;
+  };
+
+  //! geometry version
+  std::size_t version{0};
+  //! extruder printing the object, from 1
+  int extruder{1};
+  //! settings overriding the global ones
+  toml::value overrides{toml::table{}};
+  //! modifier volumes, as loaded
+  std::vector<Modifier> modifiers;
+  //! all transformations since the object was loaded, for the modifiers
+  gp_Trsf placement;
+  //! cached mass properties
+  mutable std::optional<MassProperties> mass;
+  //! cached bounds
+  std::optional<Bounds> bounds;
+
+  //! shape, possibly lagging behind the pending transformation
+  mutable std::unique_ptr<TopoDS_Shape> shape;
+  //! accumulated transformation, not yet applied to the shape
+  mutable gp_Trsf pending;
+  //! whether there is a pending transformation
+  mutable bool has_pending{false};
   const std::string filename;
   Bnd_Box bounding_box;
   Bnd_Box2d footprint;
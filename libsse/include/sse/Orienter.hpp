@@ -0,0 +1,186 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Orienter.hpp
+ * @brief Finds a good print orientation for an object
+ *
+ * This contains the prototypes for the Orienter class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <BRepAdaptor_Surface.hxx>
+#include <GeomAbs_SurfaceType.hxx>
+#include <OSD_Parallel.hxx>
+#include <Precision.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <gp_Dir.hxx>
+#include <gp_Trsf.hxx>
+#include <gp_XYZ.hxx>
+
+#include <sse/Object.hpp>
+
+#include <spdlog/spdlog.h>
+
+namespace sse {
+
+/**
+ * @class Orienter
+ * @brief Search for the print orientation of an object that needs the least
+ * support and the fewest layers.
+ *
+ * Candidate orientations lay one side of the object flat on the build plate:
+ * every planar face, and every facet of the convex hull (the only sides the
+ * object can rest on). Each candidate is scored in parallel, from the mesh of
+ * the object.
+ */
+class Orienter {
+
+public:
+  /**
+   * @struct Candidate
+   * @brief A candidate orientation, and its score
+   */
+  struct Candidate {
+    //! direction, in object coordinates, that will point down (-Z)
+    gp_Dir down;
+    //! area that needs support
+    double overhang_area{0};
+    //! area touching the build plate
+    double contact_area{0};
+    //! height of the object
+    double height{0};
+    //! estimated number of layers
+    int layers{0};
+    //! weighted cost, lower is better
+    double cost{0};
+  };
+
+  /**
+   * @struct Weights
+   * @brief Cost of each scoring criterion. The criteria are normalized, so
+   * the weights are comparable: areas as a fraction of the surface of the
+   * object, the height as a fraction of its diameter.
+   */
+  struct Weights {
+    //! cost of overhanging the whole surface
+    double overhang{1.0};
+    //! cost of resting the whole surface on the build plate (i.e. a reward)
+    double contact{-0.5};
+    //! cost of standing as tall as the diameter of the object
+    double height{1.0};
+  };
+
+  /**
+   * @brief Orienter constructor
+   * @param object Object to orient
+   * @param layer_height Layer height, to estimate the number of layers
+   * @param overhang_angle Maximum unsupported angle from vertical, in degrees
+   * @param weights Cost of each scoring criterion
+   */
+  Orienter(Object &object, double layer_height, double overhang_angle = 45.0,
+           Weights weights = Weights());
+
+  /**
+   * @brief List the candidate orientations, unscored
+   * @return List of candidates
+   */
+  std::vector<Candidate> candidates() const;
+
+  /**
+   * @brief Score all candidate orientations, in parallel
+   * @return Scored candidates, best first
+   */
+  std::vector<Candidate> evaluate() const;
+
+  /**
+   * @brief Rotate the object into the best orientation, resting on the build
+   * plate
+   * @return The chosen orientation
+   */
+  Candidate orient();
+
+private:
+  /**
+   * @struct Triangle
+   * @brief Mesh triangle, with precomputed properties
+   */
+  struct Triangle {
+    //! vertices
+    std::array<gp_XYZ, 3> vertices;
+    //! outward unit normal
+    gp_XYZ normal;
+    //! area
+    double area;
+  };
+
+  /**
+   * @brief Compute the rotation that points a direction down, about the center
+   * of the object
+   * @param down Direction to point down
+   * @return Rotation
+   */
+  gp_Trsf rotation(const gp_Dir &down) const;
+
+  /**
+   * @brief Score a candidate orientation
+   * @param c Candidate to score
+   */
+  void score(Candidate &c) const;
+
+  /**
+   * @brief Compute the outward normals of the convex hull facets of the mesh
+   * @param limit Maximum number of normals, biggest facets first
+   * @return List of facet normals
+   */
+  std::vector<gp_Dir> hull_normals(std::size_t limit) const;
+
+  //! object to orient
+  Object &object;
+  //! layer height
+  double layer_height;
+  //! faces whose normal points down more steeply than this (-Z component)
+  //! need support
+  double overhang_limit;
+  //! scoring weights
+  Weights weights;
+  //! center of rotation
+  gp_Pnt center;
+  //! mesh of the object
+  std::vector<Triangle> mesh;
+  //! surface area of the mesh
+  double area{0};
+  //! diameter of the sphere about the center enclosing the mesh, i.e. the
+  //! tallest the object can stand
+  double diameter{0};
+};
+
+} // namespace sse
@@ -0,0 +1,153 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file PathOptimizer.hpp
+ * @brief Orders the paths of a layer to minimize travel
+ *
+ * This contains the prototypes for the PathOptimizer class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <Precision.hxx>
+#include <gp_XY.hxx>
+
+#include <sse/Contour.hpp>
+
+namespace sse {
+
+/**
+ * @class PathOptimizer
+ * @brief Order the contours of a layer (islands, shells, infill) so the
+ * non-printing moves between them are short.
+ *
+ * A nearest neighbour pass builds a tour, looking up the next contour in a
+ * spatial grid of candidate entry points: every vertex of a closed loop (the
+ * loop can start anywhere), both ends of an open path (it can be printed in
+ * either direction). The tour is then improved with 2-opt, and finally the
+ * start of each loop is moved to the vertex closest to the end of the
+ * previous contour.
+ *
+ * The tour is the costly part, see sequence(); connecting it to the actual
+ * position of the tool is linear, see connect(), so that the layers of a
+ * program can be sequenced in parallel from a guessed start, then connected
+ * one after another.
+ */
+class PathOptimizer {
+
+public:
+  /**
+   * @brief PathOptimizer constructor
+   * @param start Position of the tool before the layer
+   * @param max_two_opt Above this number of contours, skip 2-opt, whose
+   * passes are quadratic
+   */
+  explicit PathOptimizer(const gp_XY &start = gp_XY(0, 0), std::size_t max_two_opt = 1000);
+
+  /**
+   * @brief Reorder the contours, reversing open paths and moving the start of
+   * loops as needed
+   * @param contours Contours of the layer
+   * @param order If not null, receives the former index of each contour, in
+   * the new order, e.g. to reorder data that goes with the contours
+   * @return Position of the tool after the layer
+   */
+  gp_XY optimize(std::vector<Contour> &contours,
+                 std::vector<std::size_t> *order = nullptr) const;
+
+  /**
+   * @brief Order the contours from the start, reversing open paths as needed,
+   * but leave the seams of the loops, see connect()
+   * @param contours Contours of the layer
+   * @param order If not null, receives the former index of each contour, in
+   * the new order
+   */
+  void sequence(std::vector<Contour> &contours,
+                std::vector<std::size_t> *order = nullptr) const;
+
+  /**
+   * @brief Join sequenced contours to the position of the tool: print them
+   * in the opposite order if the last one is closer, and start each loop at
+   * its vertex closest to the end of the previous contour
+   * @param contours Contours, in the order of sequence()
+   * @param from Position of the tool
+   * @param order If not null, the order of sequence(), updated to match
+   * @return Position of the tool after the contours
+   */
+  static gp_XY connect(std::vector<Contour> &contours, const gp_XY &from,
+                       std::vector<std::size_t> *order = nullptr);
+
+  /**
+   * @brief Total length of the moves between the contours, in their order
+   * @param contours Contours of a layer
+   * @param start Position of the tool before the layer
+   * @return Travel length
+   */
+  static double travel(const std::vector<Contour> &contours, const gp_XY &start);
+
+private:
+  /**
+   * @struct Stop
+   * @brief A contour in the tour
+   */
+  struct Stop {
+    //! index of the contour
+    std::size_t contour;
+    //! whether the contour is a loop
+    bool closed;
+    //! first vertex of a loop
+    std::size_t vertex{0};
+    //! whether an open path is printed backwards
+    bool reversed{false};
+    //! where the tool enters the contour
+    gp_XY entry;
+    //! where the tool leaves the contour
+    gp_XY exit;
+  };
+
+  /**
+   * @brief Build a tour with the nearest neighbour heuristic
+   * @param contours Contours of the layer
+   * @return Tour
+   */
+  std::vector<Stop> nearest_neighbour(const std::vector<Contour> &contours) const;
+
+  /**
+   * @brief Improve a tour with 2-opt: reverse sections of the tour (and the
+   * paths in them) as long as it shortens the travel
+   * @param tour Tour to improve
+   */
+  void two_opt(std::vector<Stop> &tour) const;
+
+  //! position of the tool before the layer
+  gp_XY start;
+  //! maximum number of contours for 2-opt
+  std::size_t max_two_opt;
+};
+
+} // namespace sse
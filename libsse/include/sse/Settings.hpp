@@ -21,6 +21,10 @@
 #include <filesystem>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 #include <toml.hpp>
@@ -33,39 +37,100 @@ namespace sse {
 
 /**
  * @brief The Settings class
- * Singleton
+ *
+ * The settings of one job, e.g. parsed from a profile. Every job has its own
+ * instance, so jobs can run concurrently in one process; an instance is only
+ * read while slicing, so it can be shared between the threads of a job.
  */
 class Settings {
 
 public:
   toml::value config;
 
+  Settings() = default;
+
+  /**
+   * @brief Create settings from a profile
+   * @param file Profile to parse
+   * @throws std::runtime_error if the file doesn't exist
+   */
+  explicit Settings(const fs::path &file) { parse(file); }
+
   /**
    * @brief Parse toml file
    * @param _file File to parse
    */
   void parse(fs::path _file);
 
+  /**
+   * @brief Override settings, e.g. those of a job; nested tables are merged,
+   * other values replaced
+   * @param overrides Table of settings, with the same names as the profile
+   * @throws std::runtime_error if overrides isn't a table
+   */
+  void merge(const toml::value &overrides);
+
   /**
    * @brief Get a setting by name, with a designated fallback
-   * @param setting Setting name
+   * @param setting Setting name, nested tables are separated by dots, e.g.
+   * "printer.build_plate.size"
    * @param fallback Fallback value
    * @param return Setting if it exists, fallback otherwise
    *
    */
-  template <typename T> T get_setting_fallback(std::string setting, T fallback) {
-    return toml::find_or(config, setting, fallback);
+  template <typename T> T get_setting_fallback(const std::string &setting, T fallback) const {
+    return find_setting<T>(config, setting).value_or(fallback);
+  }
+
+  /**
+   * @brief Find a setting in a table, e.g. a set of overrides
+   * @param table Table to search
+   * @param setting Setting name, nested tables are separated by dots
+   * @return Setting if it exists and has the right type, nothing otherwise
+   */
+  template <typename T>
+  static std::optional<T> find_setting(const toml::value &table, const std::string &setting) {
+    const auto *value = find_value(table, setting);
+    if (value == nullptr) {
+      return std::nullopt;
+    }
+    // integers are valid floating point settings, e.g. "size = 100"
+    if constexpr (std::is_floating_point_v<T>) {
+      if (value->is_integer()) {
+        return static_cast<T>(value->as_integer());
+      }
+    }
+    try {
+      return toml::get<T>(*value);
+    } catch (const toml::type_error &) {
+      return std::nullopt;
+    }
   }
 
   /**
    * @brief Get a setting
-   * @param setting Setting name
+   * @param setting Setting name, nested tables are separated by dots
    * @return return Setting
+   * @throws std::out_of_range Thrown if the setting doesn't exist
    */
-  template <typename T> T get_setting(std::string setting) {
-    return toml::find<T>(config, setting);
+  template <typename T> T get_setting(const std::string &setting) const {
+    const auto *value = find_value(config, setting);
+    if (value == nullptr) {
+      throw std::out_of_range("Setting not found: " + setting);
+    }
+    if constexpr (std::is_floating_point_v<T>) {
+      if (value->is_integer()) {
+        return static_cast<T>(value->as_integer());
+      }
+    }
+    return toml::get<T>(*value);
   }
 
+  /**
+   * @brief Return the profile the settings were parsed from, if any
+   */
+  const fs::path &get_file() const { return file; }
+
   /**
    * @brief Dump settings to string
    * @return List of strings
@@ -77,21 +142,15 @@ public:
    */
   void save();
 
-  // don't touch anything beneath here; required for singleton
+private:
+
   /**
-   * @brief getInstance Get instance of settings
-   * @return Settings instance
+   * @brief Find a setting by its dotted name
+   * @param table Table to search
+   * @param setting Setting name
+   * @return Pointer to the value, nullptr if it doesn't exist
    */
-  static Settings &getInstance() {
-    static Settings instance;
-    return instance;
-  }
-
-  Settings(Settings const &) = delete;
-  void operator=(Settings const &) = delete;
-
-private:
-  Settings() {}
+  static const toml::value *find_value(const toml::value &table, const std::string &setting);
 
   fs::path file;
 };
@@ -0,0 +1,95 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SkinDetector.hpp
+ * @brief Finds the regions of each layer that need solid infill
+ *
+ * This contains the prototypes for the SkinDetector class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <OSD_Parallel.hxx>
+#include <gp_XY.hxx>
+
+#include <sse/Contour.hpp>
+
+namespace sse {
+
+/**
+ * @class SkinDetector
+ * @brief Find the top and bottom skins of each layer: the parts of its region
+ * not covered by all of the layers above it (top), or not supported by all
+ * of the layers below it (bottom), within a number of layers.
+ *
+ * Each layer's outlines are converted to polygons once, then every layer is
+ * compared with its window of neighbours, in parallel. Everything else can
+ * get sparse infill.
+ */
+class SkinDetector {
+
+public:
+  /**
+   * @brief SkinDetector constructor
+   * @param top_layers Number of solid layers below the top surfaces
+   * @param bottom_layers Number of solid layers above the bottom surfaces
+   * @param tolerance Maximum distance between the polygons and the outlines
+   * @param min_width Skins narrower than this are dropped, e.g. the slivers
+   * along sloped walls that are thinner than an extrusion
+   */
+  SkinDetector(int top_layers, int bottom_layers, double tolerance, double min_width = 0.0);
+
+  /**
+   * @brief Find the solid regions of every layer
+   * @param layers Outlines of each layer, from the bottom up; the region of a
+   * layer is inside an odd number of its outlines
+   * @return Outlines of the solid regions of each layer
+   */
+  std::vector<std::vector<Contour>>
+  detect(const std::vector<std::vector<Contour>> &layers) const;
+
+  /**
+   * @brief Intersect two regions, e.g. to split the skin of a layer between
+   * the objects on it
+   * @param a First region
+   * @param b Second region
+   * @param tolerance Maximum distance between the polygons and the outlines
+   * @return Outlines of the intersection
+   */
+  static std::vector<Contour> intersection(const std::vector<Contour> &a,
+                                           const std::vector<Contour> &b, double tolerance);
+
+private:
+  //! number of solid layers below the top surfaces
+  int top_layers;
+  //! number of solid layers above the bottom surfaces
+  int bottom_layers;
+  //! maximum distance between the polygons and the outlines
+  double tolerance;
+  //! minimum width of a skin
+  double min_width;
+};
+
+} // namespace sse
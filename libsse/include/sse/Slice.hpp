@@ -34,14 +34,19 @@
 #include <TopTools_MapOfShape.hxx>
 #include <TopTools_HSequenceOfShape.hxx>
 #include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
 #include <TopoDS_Face.hxx>
 #include <TopoDS_Shape.hxx>
 #include <TopoDS_Wire.hxx>
 
+#include <BRep_Builder.hxx>
 #include <BRepTools.hxx>
 #include <BRepTools_WireExplorer.hxx>
 #include <BRepAdaptor_Surface.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
 #include <BRepOffsetAPI_MakeOffset.hxx>
+#include <OSD_Parallel.hxx>
+#include <Standard_Failure.hxx>
 
 #include <GeomAbs_SurfaceType.hxx>
 
@@ -52,6 +57,8 @@
 
 #include <spdlog/spdlog.h>
 
+#include <sse/CompiledSettings.hpp>
+#include <sse/Contour.hpp>
 #include <sse/Object.hpp>
 
 namespace sse {
@@ -70,6 +77,13 @@ public:
    */
   explicit Slice(TopoDS_Shape &shape);
 
+  /**
+   * @brief Create a slice directly from its bottom faces, e.g. built from the
+   * outline of a section, without a 3D slab
+   * @param layer_faces Planar faces, parallel to the XY plane
+   */
+  explicit Slice(const TopTools_ListOfShape &layer_faces);
+
   /**
    * @brief Return all the bottom faces of the slice
    * @return list of faces
@@ -77,12 +91,89 @@ public:
   inline TopTools_HSequenceOfShape& get_faces() { return faces;}
 
   /**
-   * @brief Generate shells for the slice
-   * @param num
-   * @param width
+   * @brief Set the settings of the slice, i.e. of its object
+   * @param s Settings
+   */
+  inline void set_settings(const CompiledSettings &s) { settings = s; }
+
+  /**
+   * @brief Return the settings of the slice
+   * @return settings, defaults if none were set
+   */
+  inline const CompiledSettings &get_settings() const { return settings; }
+
+  /**
+   * @brief Set the settings of one face, e.g. inside a modifier volume
+   * @param i Face index, from 1, as in get_faces()
+   * @param s Settings of the face
+   */
+  void set_face_settings(int i, const CompiledSettings &s);
+
+  /**
+   * @brief Return the settings of a face
+   * @param i Face index, from 1, as in get_faces()
+   * @return settings of the face, those of the slice if it has none of its own
+   */
+  const CompiledSettings &get_face_settings(int i) const;
+
+  /**
+   * @brief Generate the shells of the slice, i.e. inward offsets of the
+   * outline of each face; every face and shell is offset concurrently. The
+   * first shell is half a width inside the outline, so the part isn't
+   * printed oversized.
+   * @param num Number of shells
+   * @param width Distance between consecutive shells
    */
   void generate_shells(int num, double width);
 
+  /**
+   * @brief Generate the shells of the slice, with the number of shells and
+   * extrusion width of each face
+   */
+  void generate_shells();
+
+  /**
+   * @brief Convert the outlines and shells of the slice into contours, once,
+   * for the later stages, at the print height; only the shells are printed
+   * @param tolerance Maximum distance between the contours and the exact
+   * geometry
+   */
+  void generate_contours(double tolerance);
+
+  /**
+   * @brief Return the shells of the slice, from generate_shells()
+   * @return list of wires
+   */
+  inline const TopTools_ListOfShape &get_shells() const { return wires; }
+
+  /**
+   * @brief Return the contours of the slice, i.e. the paths to print
+   * @return list of contours
+   */
+  inline const std::vector<Contour> &get_contours() const { return contours; }
+  inline std::vector<Contour> &get_contours() { return contours; }
+
+  /**
+   * @brief Return the outlines of the slice, i.e. the boundaries of its
+   * faces, e.g. for combing and skins
+   * @return list of contours
+   */
+  inline const std::vector<Contour> &get_outlines() const { return outlines; }
+
+  /**
+   * @brief Set the regions of the slice that need solid infill
+   * @param regions Outlines of the solid regions
+   */
+  inline void set_skin(std::vector<Contour> regions) { skin = std::move(regions); }
+
+  /**
+   * @brief Return the regions of the slice that need solid infill, i.e. its
+   * top and bottom skins; the rest gets sparse infill
+   * @return list of outlines, empty unless skins were detected, see the
+   * "detect_skins" setting
+   */
+  inline const std::vector<Contour> &get_skin() const { return skin; }
+
   // TODO: configurable infill pattern
   /**
    * @brief generate_infill
@@ -90,17 +181,41 @@ public:
    */
   void generate_infill(double percent, double angle, double line_width);
 
+  /**
+   * @brief Height the slice is printed at, i.e. the top of its slab: its
+   * bottom plus its layer height
+   */
+  double print_height() const;
+
   /**
    * @brief operator < Comparator t
    * @param rhs Other slice to compare against
-   * @return Whether the lowest point of this bounding box is above the lowest point in the other bounding box
+   * @return Whether this slice is printed below the other one
    */
   bool operator <(const Slice& rhs) const;
 
 private:
   //! list of faces
   TopTools_HSequenceOfShape faces;
+  //! shells, as wires
   TopTools_ListOfShape wires;
+  //! paths to print, detached from the topology
+  std::vector<Contour> contours;
+  //! boundaries of the faces, e.g. to keep travel moves inside them
+  std::vector<Contour> outlines;
+  //! regions that need solid infill
+  std::vector<Contour> skin;
+  //! settings of the slice
+  CompiledSettings settings;
+  //! settings of the faces that differ from those of the slice, by index
+  std::map<int, CompiledSettings> face_settings;
+
+  /**
+   * @brief Offset the outline of each face
+   * @param shells Number of shells of each face
+   * @param widths Distance between the shells of each face
+   */
+  void offset_faces(const std::vector<int> &shells, const std::vector<double> &widths);
 };
 
 } // namespace sse
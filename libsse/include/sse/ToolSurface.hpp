@@ -0,0 +1,170 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ToolSurface.hpp
+ * @brief Families of (non-planar) slicing surfaces
+ *
+ * This contains the prototypes for the ToolSurface classes
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <Bnd_Box.hxx>
+#include <Geom_ConicalSurface.hxx>
+#include <Geom_SphericalSurface.hxx>
+#include <Precision.hxx>
+#include <TopoDS_Face.hxx>
+#include <TopoDS_Wire.hxx>
+#include <gp.hxx>
+#include <gp_Ax3.hxx>
+#include <gp_Pln.hxx>
+#include <gp_Pnt.hxx>
+
+namespace sse {
+
+/**
+ * @struct SurfaceLayer
+ * @brief Toolpaths on one tool surface
+ */
+struct SurfaceLayer {
+  //! height of the tool surface on its axis, used to order layers
+  double z;
+  //! paths along the intersection of the tool surface and the object
+  std::vector<TopoDS_Wire> paths;
+};
+
+/**
+ * @class ToolSurface
+ * @brief A family of slicing surfaces, one per layer, covering a region.
+ *
+ * Each layer is a bounded face, generated independently of the others, so
+ * layers can be generated and intersected in parallel.
+ */
+class ToolSurface {
+
+public:
+  /**
+   * @brief ToolSurface constructor
+   * @param bounds Region to slice
+   * @param layer_height Distance between consecutive surfaces
+   * @throws std::runtime_error if the region is empty or the layer height
+   * isn't positive
+   */
+  ToolSurface(const Bnd_Box &bounds, double layer_height);
+
+  virtual ~ToolSurface() = default;
+
+  /**
+   * @brief Number of layers needed to cover the region
+   */
+  std::size_t count() const { return layers; }
+
+  /**
+   * @brief Height of a layer on the axis of the region
+   * @param i Layer index
+   */
+  double height(std::size_t i) const { return start + i * layer_height; }
+
+  /**
+   * @brief Generate the face of a layer
+   * @param i Layer index
+   * @return Bounded face, covering the region
+   */
+  virtual TopoDS_Face face(std::size_t i) const = 0;
+
+protected:
+  //! bounds of the region, without gap
+  double xmin, ymin, zmin, xmax, ymax, zmax;
+  //! center of the bottom of the region
+  gp_Pnt center;
+  //! radius of the region, in XY
+  double radius;
+  //! distance between consecutive surfaces
+  double layer_height;
+  //! height of the first layer
+  double start{0};
+  //! number of layers
+  std::size_t layers{0};
+};
+
+/**
+ * @class PlanarToolSurface
+ * @brief Horizontal planes, i.e. conventional slicing
+ */
+class PlanarToolSurface : public ToolSurface {
+public:
+  PlanarToolSurface(const Bnd_Box &bounds, double layer_height);
+  TopoDS_Face face(std::size_t i) const override;
+};
+
+/**
+ * @class ConicalToolSurface
+ * @brief Cones about the vertical axis of the region, e.g. to print
+ * overhangs on the outside (positive slope) or inside (negative slope) of an
+ * object without support
+ */
+class ConicalToolSurface : public ToolSurface {
+public:
+  /**
+   * @brief ConicalToolSurface constructor
+   * @param bounds Region to slice
+   * @param layer_height Distance between consecutive cones
+   * @param angle Slope of the cone from horizontal, in degrees, in (-90, 90)
+   */
+  ConicalToolSurface(const Bnd_Box &bounds, double layer_height, double angle);
+  TopoDS_Face face(std::size_t i) const override;
+
+private:
+  //! rise per unit of radius
+  double slope;
+};
+
+/**
+ * @class SphericalToolSurface
+ * @brief Concentric spherical caps, i.e. each layer is the offset of the
+ * previous one, e.g. for domes
+ */
+class SphericalToolSurface : public ToolSurface {
+public:
+  /**
+   * @brief SphericalToolSurface constructor
+   * @param bounds Region to slice
+   * @param layer_height Distance between consecutive spheres
+   * @param sphere_radius Radius of the lowest sphere, whose top touches the
+   * bottom of the region
+   */
+  SphericalToolSurface(const Bnd_Box &bounds, double layer_height,
+                       double sphere_radius);
+  TopoDS_Face face(std::size_t i) const override;
+
+private:
+  //! radius of the lowest sphere
+  double sphere_radius;
+};
+
+} // namespace sse
@@ -0,0 +1,134 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TravelPlanner.hpp
+ * @brief Routes travel moves inside a layer, to avoid retractions
+ *
+ * This contains the prototypes for the TravelPlanner class
+ *
+ * @author Karl Nilsson
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <Precision.hxx>
+#include <gp_XY.hxx>
+
+#include <sse/Contour.hpp>
+
+namespace sse {
+
+/**
+ * @class TravelPlanner
+ * @brief Route travel moves ("combing") inside the outlines of a layer, so
+ * the nozzle doesn't need to retract.
+ *
+ * A move that stays inside the region crosses no perimeter and needs no
+ * retraction. Otherwise, a shortest path inside the region is searched with
+ * A* over a visibility graph, whose nodes are the vertices of the outlines,
+ * moved slightly inwards. Only moves that must leave the region, e.g. between
+ * islands, need a retraction.
+ *
+ * The edges of the outlines are indexed by a uniform grid, so that a query
+ * only tests the edges near the move, and the visibility between two nodes is
+ * computed once per planner, i.e. per layer, then shared by all its moves.
+ * Routing isn't thread safe.
+ */
+class TravelPlanner {
+
+public:
+  /**
+   * @brief TravelPlanner constructor
+   * @param outlines Closed outlines of the layer; the region is inside an odd
+   * number of them, i.e. holes are excluded
+   * @param tolerance Maximum distance between the polygons and the outlines
+   * @param clearance Distance between the routes and the outlines
+   * @param max_vertices Above this number of polygon vertices, don't search
+   * routes around the outlines, as the visibility graph grows with the
+   * square of the number of vertices
+   */
+  TravelPlanner(const std::vector<Contour> &outlines, double tolerance,
+                double clearance = 0.2, std::size_t max_vertices = 1000);
+
+  /**
+   * @brief Whether a point is inside the region
+   */
+  bool inside(const gp_XY &p) const;
+
+  /**
+   * @brief Whether the straight move between two points stays in the region:
+   * it crosses no outline, and its middle is inside
+   */
+  bool visible(const gp_XY &a, const gp_XY &b) const;
+
+  /**
+   * @brief Find a travel route inside the region
+   * @param a Start of the move
+   * @param b End of the move
+   * @param path Points after the start, up to the end included
+   * @return false if the move must leave the region, i.e. needs a retraction
+   */
+  bool route(const gp_XY &a, const gp_XY &b, std::vector<gp_XY> &path) const;
+
+private:
+  /**
+   * @brief Whether the segment properly crosses an edge of the outlines
+   */
+  bool crosses(const gp_XY &a, const gp_XY &b) const;
+
+  /**
+   * @brief Whether two nodes of the graph see each other, from the cache
+   */
+  bool visible(std::size_t i, std::size_t j) const;
+
+  /**
+   * @brief Index of the column or row of a coordinate, clamped to the grid
+   */
+  int cell(double coordinate, double low, int count) const;
+
+  //! edges of the outline polygons
+  std::vector<std::pair<gp_XY, gp_XY>> edges;
+  //! lower left corner of the grid
+  gp_XY origin;
+  //! side of the square cells of the grid
+  double size{1};
+  //! number of columns and rows of the grid
+  int columns{0}, rows{0};
+  //! edges overlapping each cell, row by row
+  std::vector<std::vector<std::size_t>> cells;
+  //! edges overlapping each row, for the ray casting of inside()
+  std::vector<std::vector<std::size_t>> bands;
+  //! nodes of the visibility graph: polygon vertices, moved inwards
+  std::vector<gp_XY> nodes;
+  //! visibility between each pair of nodes: 0 unknown, 1 visible, 2 hidden
+  mutable std::vector<std::uint8_t> visibility;
+  //! whether the graph is too big to search
+  bool too_complex{false};
+};
+
+} // namespace sse
@@ -35,55 +35,105 @@
 #include <TDF_Attribute.hxx>
 
 #include <Geom2d_Line.hxx>
+#include <GProp_GProps.hxx>
 #include <GeomFill_Pipe.hxx>
 #include <Geom_CylindricalSurface.hxx>
 
 #include <GCE2d_MakeSegment.hxx>
 
 #include <gp.hxx>
+#include <gp_Ax3.hxx>
 #include <gp_Lin2d.hxx>
 #include <gp_Pln.hxx>
 #include <gp_Pnt2d.hxx>
 
 #include <BOPAlgo_Section.hxx>
 #include <BOPAlgo_Tools.hxx>
+#include <BOPTools_AlgoTools3D.hxx>
+#include <IntTools_Context.hxx>
 #include <BRepAlgo.hxx>
+#include <BRepAlgoAPI_Section.hxx>
 #include <BRepAlgoAPI_Splitter.hxx>
 #include <BRepBuilderAPI.hxx>
+#include <BRepClass3d_SolidClassifier.hxx>
 #include <BRepBuilderAPI_Copy.hxx>
 #include <BRepBuilderAPI_MakeEdge.hxx>
 #include <BRepBuilderAPI_MakeFace.hxx>
 #include <BRepBuilderAPI_MakeWire.hxx>
+#include <BRepGProp.hxx>
+#include <BRepLib.hxx>
 #include <BRepOffsetAPI_MakePipe.hxx>
+#include <BRepOffsetAPI_MakePipeShell.hxx>
 #include <BRepTools.hxx>
 #include <BRepTools_WireExplorer.hxx>
 #include <BRep_Tool.hxx>
 // STL headers
+#include <algorithm>
+#include <array>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <numeric>
 #include <optional>
 #include <string>
 #include <vector>
 // SSE headers
+#include <sse/ImportCache.hpp>
 #include <sse/Importer.hpp>
 #include <sse/Object.hpp>
 #include <sse/Settings.hpp>
+#include <sse/CompiledSettings.hpp>
 #include <sse/Slice.hpp>
 #include <sse/version.hpp>
 #include <sse/Packer.hpp>
+#include <sse/Nester.hpp>
+#include <sse/Orienter.hpp>
+#include <sse/ToolSurface.hpp>
 #include <sse/GCodeWriter.hpp>
+#include <sse/PathOptimizer.hpp>
+#include <sse/TravelPlanner.hpp>
+#include <sse/SkinDetector.hpp>
 // external headers
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
 namespace sse {
 
+/**
+ * @brief The Slicer class
+ *
+ * A slicing job: its settings and logger belong to the instance, so several
+ * jobs can run concurrently in one process.
+ */
 class Slicer {
 public:
+  /**
+   * @brief Create a job from a profile, logging to stderr
+   * @param configfile Profile
+   * @param loglevel Log level of the job
+   * @throws std::runtime_error if the profile doesn't exist
+   */
   Slicer(const fs::path configfile,
          const spdlog::level::level_enum loglevel = spdlog::level::info);
 
+  /**
+   * @brief Create a job from its settings
+   * @param settings Settings of the job
+   * @param logger Logger of the job, e.g. to report to a client
+   */
+  Slicer(Settings settings, std::shared_ptr<spdlog::logger> logger);
+
+  /**
+   * @brief Return the settings of the job
+   */
+  const Settings &get_settings() const { return settings; }
+
+  /**
+   * @brief Return the logger of the job
+   */
+  const std::shared_ptr<spdlog::logger> &get_logger() const { return logger; }
+
   /**
    * @brief init_settings
    * @param configfile
@@ -91,29 +141,129 @@ public:
   void init_settings(fs::path configfile);
 
   /**
-   * @brief Slice a list of solids using the splitter algorithm
+   * @brief Load the settings of an object from the profile, i.e. the
+   * objects."<file name>" table, whose keys override the global settings, and
+   * whose "modifiers" array lists the volumes, each with a "file" and its own
+   * "shells" and "extrusion_width", that override the settings of the
+   * regions inside them
+   * @param object Object to configure, before it's transformed
+   * @param cache Cache importing the modifiers; relative paths are resolved
+   * against the directory of the profile
+   * @throws std::runtime_error if a modifier can't be imported, or has a
+   * setting that doesn't apply to a region, e.g. "layer_height"
+   */
+  void load_object_settings(Object &object, ImportCache &cache);
+
+  /**
+   * @brief Resolve the settings of an object, or of one of its regions
+   * @param object Object
+   * @param region Overrides of the region, e.g. of a modifier, if any
+   * @return Settings: those of the region, then the object, then the global
+   * ones
+   * @throws std::runtime_error if a setting is out of range
+   */
+  CompiledSettings compile_settings(const Object &object,
+                                    const toml::value *region = nullptr) const;
+
+  /**
+   * @brief Slice a list of solids, using the splitter algorithm, or the section
+   * algorithm if the "slicing_mode" setting is "section". Each object is
+   * sliced in parallel, as an independent task, with its own settings, then
+   * the slices are merged. The faces inside a modifier volume take its
+   * settings.
    * @param objects Objects to split
-   * @return the resulting shape(s)
+   * @return the resulting shape(s), sorted by print height
    */
   std::vector<std::unique_ptr<Slice>>
   slice(const std::vector<std::shared_ptr<Object>> &objects);
 
   /**
-   * @brief Create a list of slicing planes
-   * @param layerHeight Distance between planes
-   * @param objectHeight Total height
-   * @return A list of tools (planar faces) to slice an object
+   * @brief Create slicing planes, on a grid common to all objects, as faces
+   * bounded to the XY bounds of an object, plus a margin, within its Z range
+   * @param layer_height Distance between planes
+   * @param bounds Bounds of the object to slice, its gap is ignored
+   * @return A list of tools (planar faces)
+   */
+  static TopTools_ListOfShape make_tools(const double layer_height,
+                                         const Bnd_Box &bounds);
+
+  /**
+   * @brief Slice objects in spiral (vase) mode: each object is intersected with
+   * a single helical tool surface, giving one continuous toolpath that rises
+   * steadily, without layer changes
+   * @param objects Objects to slice
+   * @return One continuous path per object, along its outer wall
+   */
+  std::vector<TopoDS_Wire>
+  slice_spiral(const std::vector<std::shared_ptr<Object>> &objects);
+
+  /**
+   * @brief Create the family of tool surfaces configured by the
+   * "slicing_surface" setting ("planar", "conical" or "spherical"), covering a
+   * region
+   * @param bounds Region to slice
+   * @param layer_height Distance between consecutive surfaces
+   * @return Tool surfaces
+   */
+  std::unique_ptr<ToolSurface> make_tool_surface(const Bnd_Box &bounds,
+                                                 const double layer_height);
+
+  /**
+   * @brief Slice objects with a family of (non-planar) tool surfaces. Each
+   * surface is generated and intersected with the object in parallel.
+   * @param objects Objects to slice
+   * @return Toolpaths, one layer per tool surface, ordered by height
+   */
+  std::vector<SurfaceLayer>
+  slice_surfaces(const std::vector<std::shared_ptr<Object>> &objects);
+
+  /**
+   * @brief Generate G-code for toolpaths, following Z along each path, after
+   * the header
+   * @param layers Toolpaths
+   * @return G-code program
+   */
+  std::string generate_toolpaths(const std::vector<SurfaceLayer> &layers);
+
+  /**
+   * @brief Generate G-code for slices, from their contours. The slices of each
+   * layer are grouped by extruder, in the order given by schedule_extruders(),
+   * with an optional prime tower ("prime_tower" setting) purging each
+   * extruder after a tool change. The machine state at the start of each
+   * layer is planned first, ordering the paths of each extruder from where the
+   * previous one ends ("path_optimization" setting), then the layers are
+   * rendered in parallel.
+   * @param slices Slices, sorted by print height
+   * @return G-code program: the header, then one chunk per layer, in order;
+   * see GCodeWriter::write()
+   * @throws std::runtime_error if an object's extruder isn't on the printer
    */
-  TopTools_ListOfShape makeTools(const double layerHeight,
-                                 const double objectHeight);
+  std::vector<std::string>
+  generate_gcode(const std::vector<std::unique_ptr<Slice>> &slices);
 
   /**
-   * @brief makeSpiralFace
-   * @param height
-   * @param radius
-   * @return
+   * @brief Order the extruders of each layer to minimize tool changes: each
+   * layer starts with the extruder the previous one ended with, and ends with
+   * one the next layer uses, if possible
+   * @param layers Extruders used by each layer, from the bottom up
+   * @param initial Extruder before the first layer
+   * @return Extruders of each layer, in printing order, without duplicates
    */
-  TopoDS_Face make_spiral_face(const double height, const double layer_height);
+  static std::vector<std::vector<int>>
+  schedule_extruders(const std::vector<std::vector<int>> &layers, int initial);
+
+  /**
+   * @brief Create a helicoid, i.e. the surface swept by a horizontal line
+   * rotating about a vertical axis while rising one layer per turn
+   * @param center Center of the bottom of the helicoid, on its axis
+   * @param radius Radius of the helicoid
+   * @param height Height of the helicoid
+   * @param layer_height Rise per turn
+   * @return Helicoid face
+   * @throws std::runtime_error if the sweep fails
+   */
+  TopoDS_Face make_spiral_face(const gp_Pnt &center, const double radius,
+                               const double height, const double layer_height);
 
   /**
    * @brief Recursively dump shape info to log
@@ -130,24 +280,73 @@ public:
    */
   void arrange_objects(std::vector<std::shared_ptr<Object>> objects);
 
+  /**
+   * @brief Rotate each object into the orientation needing the least support
+   * and the fewest layers, resting on the build plate
+   * @param objects List of objects
+   */
+  void orient_objects(std::vector<std::shared_ptr<Object>> objects);
+
   void make_build_volume();
 
   /**
-   * @brief section use the section algorithm to obtain a list of edges from an
-   * intersection
-   * @param objects
-   * @param tools
+   * @brief Slice a single object into layer faces, using the section algorithm:
+   * only the outline at each Z is computed, then filled into faces, without
+   * building 3D slabs
+   * @param object Object to section
+   * @param layer_height Distance between layers
+   * @return Slices of the object, sorted by height
+   * @throws std::runtime_error if a section fails
    */
-  void section(const TopTools_ListOfShape &objects,
-               const TopTools_ListOfShape &tools);
-
+  std::vector<std::unique_ptr<Slice>> section_object(Object &object,
+                                                     const double layer_height);
 private:
-  Settings &settings;
+  //! settings of the job
+  Settings settings;
+  //! logger of the job
+  std::shared_ptr<spdlog::logger> logger;
+
+  /**
+   * @brief Split a single object into slices
+   * @param object Object to split
+   * @param layer_height Distance between slices
+   * @return Slices of the object, unsorted
+   * @throws std::runtime_error if the split fails
+   */
+  std::vector<std::unique_ptr<Slice>> slice_object(Object &object,
+                                                   const double layer_height);
+
+  /**
+   * @brief Describe a shape and its sub-shapes, as a tree
+   * @param shape Shape to describe
+   * @param depth Depth of the shape in the tree
+   */
+  static std::string dump_recurse(const TopoDS_Shape &shape, int depth = 0);
 
-  TopTools_ListOfShape make_tools(const double layer_height,
-                                  const double object_height);
+  /**
+   * @brief Apply the settings of the modifiers containing each face of the
+   * slices of an object; the last modifier wins
+   * @param object Object the slices belong to
+   * @param slices Slices of the object
+   */
+  void apply_modifiers(const Object &object,
+                       const std::vector<std::unique_ptr<Slice>> &slices) const;
 
-  std::string dump_recurse(const TopoDS_Shape &shape);
+  /**
+   * @brief Generate the shells, contours and, if the "detect_skins" setting
+   * is set, skins of the slices of one object, with its settings
+   * @param slices Slices of the object, sorted by height
+   */
+  void generate_layers(const std::vector<std::unique_ptr<Slice>> &slices) const;
+
+  /**
+   * @brief Group the slices of all objects by layer, i.e. by print height, so
+   * the tool never goes below what's already printed
+   * @param slices Slices, sorted by print height
+   * @return Slices of each layer, from the bottom up
+   */
+  static std::vector<std::vector<Slice *>>
+  layer_groups(const std::vector<std::unique_ptr<Slice>> &slices);
 };
 
 } // namespace sse
@@ -0,0 +1,114 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Batch.cpp
+ * @brief Many slicing jobs from a manifest, run concurrently
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/Batch.hpp>
+
+namespace sse {
+
+Batch Batch::from_file(const fs::path &manifest) {
+  if (!fs::exists(manifest)) {
+    throw std::runtime_error("Error, file does not exist: " + manifest.string());
+  }
+  return from_toml(toml::parse(manifest), manifest.parent_path());
+}
+
+Batch Batch::from_toml(const toml::value &table, const fs::path &base) {
+  const auto resolve = [&](const fs::path &p) { return p.is_relative() ? base / p : p; };
+  const auto profile = Settings::find_setting<std::string>(table, "profile");
+  const auto jobs = Settings::find_setting<toml::array>(table, "jobs");
+  if (!jobs || jobs->empty()) {
+    throw std::runtime_error("Batch: no jobs");
+  }
+
+  auto result = Batch();
+  for (std::size_t i = 0; i < jobs->size(); ++i) {
+    auto job = (*jobs)[i];
+    if (!job.is_table()) {
+      throw std::runtime_error(fmt::format("Batch: job {} isn't a table", i + 1));
+    }
+    // jobs without a profile use the one of the manifest
+    if (profile && !Settings::find_setting<std::string>(job, "profile")) {
+      job.as_table()["profile"] = *profile;
+    }
+    const auto output = Settings::find_setting<std::string>(job, "output");
+    if (!output) {
+      throw std::runtime_error(fmt::format("Batch: job {} has no output", i + 1));
+    }
+    auto entry = Entry();
+    try {
+      entry.description = JobDescription::from_toml(job);
+    } catch (const std::runtime_error &e) {
+      throw std::runtime_error(fmt::format("Batch: job {}: {}", i + 1, e.what()));
+    }
+    for (auto &f : entry.description.files) {
+      f = resolve(f).string();
+    }
+    entry.description.profile = resolve(entry.description.profile);
+    entry.output = resolve(*output);
+    result.entries.push_back(std::move(entry));
+  }
+  return result;
+}
+
+std::vector<Batch::Result> Batch::run(ImportCache &cache, unsigned threads) const {
+  auto results = std::vector<Result>(entries.size());
+  // every thread takes the next job, until there are none left
+  auto next = std::atomic<std::size_t>(0);
+  const auto work = [&]() {
+    for (auto i = next++; i < entries.size(); i = next++) {
+      const auto &entry = entries[i];
+      auto &result = results[i];
+      result.output = entry.output;
+      // the job logs to the default sinks, under its own name
+      const auto &sinks = spdlog::default_logger()->sinks();
+      const auto logger = std::make_shared<spdlog::logger>(entry.output.filename().string(),
+                                                           sinks.begin(), sinks.end());
+      logger->set_level(spdlog::default_logger()->level());
+      const auto start = std::chrono::steady_clock::now();
+      try {
+        GCodeWriter::write(entry.output, Job(entry.description, cache, logger).run());
+      } catch (const std::exception &e) {
+        logger->error(e.what());
+        result.error = e.what();
+      }
+      result.seconds =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+
+  auto pool = std::vector<std::thread>();
+  const auto count = std::min<std::size_t>(std::max(threads, 1u), entries.size());
+  for (std::size_t t = 1; t < count; ++t) {
+    pool.emplace_back(work);
+  }
+  // the calling thread is one of the workers
+  work();
+  for (auto &t : pool) {
+    t.join();
+  }
+  return results;
+}
+
+} // namespace sse
@@ -0,0 +1,74 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file CompiledSettings.cpp
+ * @brief Print settings resolved for one object or region
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/CompiledSettings.hpp>
+
+namespace sse {
+
+CompiledSettings CompiledSettings::compile(const Settings &global,
+                                           const std::vector<const toml::value *> &overrides) {
+  // the most specific source that has the setting wins
+  const auto lookup = [&](const std::string &name, auto fallback) {
+    using T = decltype(fallback);
+    for (auto it = overrides.rbegin(); it != overrides.rend(); ++it) {
+      if (*it == nullptr) {
+        continue;
+      }
+      if (const auto value = Settings::find_setting<T>(**it, name)) {
+        return *value;
+      }
+    }
+    return global.get_setting_fallback<T>(name, fallback);
+  };
+
+  auto result = CompiledSettings();
+  result.layer_height = lookup("layer_height", result.layer_height);
+  result.sectioning = lookup("slicing_mode", std::string("split")) == "section";
+  result.shells = lookup("shells", result.shells);
+  result.extrusion_width = lookup("extrusion_width", result.extrusion_width);
+  result.infill_density = lookup("infill_density", result.infill_density);
+  result.top_layers = lookup("top_layers", result.top_layers);
+  result.bottom_layers = lookup("bottom_layers", result.bottom_layers);
+  result.tolerance = lookup("tolerance", result.tolerance);
+
+  if (result.layer_height <= 0) {
+    throw std::runtime_error("CompiledSettings: invalid layer height");
+  }
+  if (result.extrusion_width <= 0) {
+    throw std::runtime_error("CompiledSettings: invalid extrusion width");
+  }
+  if (result.shells < 0 || result.top_layers < 0 || result.bottom_layers < 0) {
+    throw std::runtime_error("CompiledSettings: invalid number of layers or shells");
+  }
+  if (result.infill_density < 0 || result.infill_density > 1) {
+    throw std::runtime_error("CompiledSettings: invalid infill density");
+  }
+  if (result.tolerance <= 0) {
+    throw std::runtime_error("CompiledSettings: invalid tolerance");
+  }
+  return result;
+}
+
+} // namespace sse
@@ -0,0 +1,340 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Contour.cpp
+ * @brief Planar toolpath contours, detached from the OCCT topology
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/Contour.hpp>
+
+namespace sse {
+
+// maximum depth of the adaptive subdivision of cubics, i.e. at most 2^16 lines
+constexpr int MAX_DEPTH = 16;
+
+namespace {
+
+/**
+ * @brief Append a planar B-spline or Bezier edge to a contour, as cubic Bezier
+ * segments
+ * @return false if the curve can't be converted, e.g. it isn't parallel to XY
+ */
+bool add_spline(const BRepAdaptor_Curve &curve, bool reversed, double tolerance,
+                Contour &contour) {
+  Handle(Geom_BSplineCurve) spline;
+  if (curve.GetType() == GeomAbs_BezierCurve) {
+    spline = GeomConvert::CurveToBSplineCurve(curve.Bezier());
+  } else {
+    // copy, the adaptor may return the geometry of the edge itself
+    spline = Handle(Geom_BSplineCurve)::DownCast(curve.BSpline()->Copy());
+  }
+  if (spline.IsNull()) {
+    return false;
+  }
+  // restrict the curve to the edge
+  const double first = curve.FirstParameter(), last = curve.LastParameter();
+  if (first > spline->FirstParameter() + Precision::PConfusion() ||
+      last < spline->LastParameter() - Precision::PConfusion()) {
+    spline->Segment(first, last);
+  }
+  if (spline->Degree() < 3) {
+    spline->IncreaseDegree(3);
+  } else if (spline->Degree() > 3) {
+    // degree reduction: approximate with a cubic spline
+    auto approx = GeomConvert_ApproxCurve(spline, tolerance, GeomAbs_C1, 100, 3);
+    if (!approx.HasResult()) {
+      return false;
+    }
+    spline = approx.Curve();
+  }
+  for (int i = 1; i <= spline->NbPoles(); ++i) {
+    if (std::abs(spline->Pole(i).Z() - contour.z) > tolerance) {
+      return false;
+    }
+  }
+  if (reversed) {
+    spline->Reverse();
+  }
+  // split at the knots into Bezier segments
+  auto beziers = GeomConvert_BSplineCurveToBezierCurve(spline);
+  for (int i = 1; i <= beziers.NbArcs(); ++i) {
+    const auto b = beziers.Arc(i);
+    auto c = Contour::Cubic();
+    c.controls = {b->Pole(2).XY(), b->Pole(3).XY()};
+    for (int k = 0; k < 4; ++k) {
+      c.weights[k] = b->Weight(k + 1);
+    }
+    contour.cubic_to(b->Pole(4).XY(), c);
+  }
+  return true;
+}
+
+/**
+ * @brief Distance from a point to a chord
+ */
+double chord_distance(const gp_XY &p, const gp_XY &a, const gp_XY &b) {
+  const auto chord = b - a;
+  const double length = chord.Modulus();
+  if (length < Precision::Confusion()) {
+    return (p - a).Modulus();
+  }
+  return std::abs(chord.Crossed(p - a)) / length;
+}
+
+/**
+ * @brief Adaptive subdivision of a cubic segment: split the parameter range in
+ * two until the curve is within the tolerance of its chord, so flat parts get
+ * long lines and tight bends short ones
+ */
+void subdivide(const Contour &c, std::size_t i, double t0, const gp_XY &p0, double t1,
+               const gp_XY &p1, double tolerance, int depth, std::vector<gp_XY> &out) {
+  const double tm = (t0 + t1) / 2;
+  const auto pm = c.evaluate(i, tm);
+  // the middle alone misses S-shaped spans, check the quarters too
+  bool flat = depth >= MAX_DEPTH ||
+              (chord_distance(pm, p0, p1) <= tolerance &&
+               chord_distance(c.evaluate(i, (t0 + tm) / 2), p0, p1) <= tolerance &&
+               chord_distance(c.evaluate(i, (tm + t1) / 2), p0, p1) <= tolerance);
+  if (flat) {
+    out.push_back(p1);
+    return;
+  }
+  subdivide(c, i, t0, p0, tm, pm, tolerance, depth + 1, out);
+  subdivide(c, i, tm, pm, t1, p1, tolerance, depth + 1, out);
+}
+
+} // namespace
+
+Contour Contour::from_wire(const TopoDS_Wire &wire, double tolerance) {
+  auto result = Contour();
+  // the explorer follows the connectivity of the wire
+  for (BRepTools_WireExplorer we(wire); we.More(); we.Next()) {
+    const auto &edge = we.Current();
+    auto curve = BRepAdaptor_Curve(edge);
+    const bool reversed = edge.Orientation() == TopAbs_REVERSED;
+    const double first = curve.FirstParameter(), last = curve.LastParameter();
+    if (result.points.empty()) {
+      const auto p = curve.Value(reversed ? last : first);
+      result.z = p.Z();
+      result.move_to(p.XY());
+    }
+
+    if (curve.GetType() == GeomAbs_Circle &&
+        curve.Circle().Axis().Direction().IsParallel(gp::DZ(), Precision::Angular())) {
+      const auto circle = curve.Circle();
+      // the parameter of a circle increases counterclockwise about its axis
+      const bool ccw = (circle.Axis().Direction().Z() > 0) != reversed;
+      // split into arcs of at most half a turn, full circles are ambiguous
+      const int pieces = std::max(
+          1, static_cast<int>(std::ceil((last - first) / M_PI - Precision::Angular())));
+      const double step = (last - first) / pieces;
+      for (int k = 1; k <= pieces; ++k) {
+        const double u = reversed ? last - k * step : first + k * step;
+        result.arc_to(curve.Value(u).XY(), circle.Location().XY(), ccw);
+      }
+    } else if ((curve.GetType() == GeomAbs_BSplineCurve ||
+                curve.GetType() == GeomAbs_BezierCurve) &&
+               add_spline(curve, reversed, tolerance, result)) {
+      // appended as cubic segments
+    } else {
+      // the deflection alone bounds the chord error, with fewer points than
+      // an additional angular criterion on gentle curves
+      auto points = GCPnts_QuasiUniformDeflection(curve, tolerance);
+      const int n = points.NbPoints();
+      for (int i = 2; i <= n; ++i) {
+        result.line_to(points.Value(reversed ? n + 1 - i : i).XY());
+      }
+    }
+  }
+  // snap the end onto the start, so closed() is exact
+  if (result.size() > 1 &&
+      result.points.front().IsEqual(result.points.back(), Precision::Confusion())) {
+    result.points.back() = result.points.front();
+  }
+  return result;
+}
+
+bool Contour::Cubic::rational() const {
+  return std::any_of(weights.begin(), weights.end(), [&](double w) {
+    return std::abs(w - weights[0]) > Precision::Confusion();
+  });
+}
+
+void Contour::move_to(const gp_XY &p) {
+  points.clear();
+  segments.clear();
+  centers.clear();
+  indices.clear();
+  cubics.clear();
+  points.push_back(p);
+}
+
+void Contour::line_to(const gp_XY &p) {
+  // skip degenerate segments, e.g. shared vertices between edges
+  if (points.back().IsEqual(p, Precision::Confusion())) {
+    return;
+  }
+  points.push_back(p);
+  segments.push_back(Segment::Line);
+  centers.push_back(p);
+  indices.push_back(0);
+}
+
+void Contour::arc_to(const gp_XY &p, const gp_XY &center, bool ccw) {
+  if (points.back().IsEqual(p, Precision::Confusion())) {
+    return;
+  }
+  points.push_back(p);
+  segments.push_back(ccw ? Segment::ArcCCW : Segment::ArcCW);
+  centers.push_back(center);
+  indices.push_back(0);
+}
+
+void Contour::cubic_to(const gp_XY &p, const Cubic &c) {
+  points.push_back(p);
+  segments.push_back(Segment::Cubic);
+  centers.push_back(p);
+  indices.push_back(static_cast<std::uint32_t>(cubics.size()));
+  cubics.push_back(c);
+}
+
+void Contour::reverse() {
+  std::reverse(points.begin(), points.end());
+  std::reverse(segments.begin(), segments.end());
+  std::reverse(centers.begin(), centers.end());
+  std::reverse(indices.begin(), indices.end());
+  for (auto &s : segments) {
+    if (s == Segment::ArcCW) {
+      s = Segment::ArcCCW;
+    } else if (s == Segment::ArcCCW) {
+      s = Segment::ArcCW;
+    }
+  }
+  for (auto &c : cubics) {
+    std::swap(c.controls[0], c.controls[1]);
+    std::reverse(c.weights.begin(), c.weights.end());
+  }
+}
+
+void Contour::rotate(std::size_t vertex) {
+  if (!closed() || vertex == 0 || vertex >= size()) {
+    return;
+  }
+  // the last point duplicates the first one
+  points.pop_back();
+  std::rotate(points.begin(), points.begin() + vertex, points.end());
+  points.push_back(points.front());
+  std::rotate(segments.begin(), segments.begin() + vertex, segments.end());
+  std::rotate(centers.begin(), centers.begin() + vertex, centers.end());
+  std::rotate(indices.begin(), indices.begin() + vertex, indices.end());
+}
+
+gp_XY Contour::evaluate(std::size_t i, double t) const {
+  const auto &c = cubic(i);
+  const std::array<gp_XY, 4> p = {start(i), c.controls[0], c.controls[1], end(i)};
+  // Bernstein polynomials
+  const double s = 1 - t;
+  const std::array<double, 4> b = {s * s * s, 3 * s * s * t, 3 * s * t * t, t * t * t};
+  auto sum = gp_XY(0, 0);
+  double weight = 0;
+  for (int k = 0; k < 4; ++k) {
+    sum += p[k] * (b[k] * c.weights[k]);
+    weight += b[k] * c.weights[k];
+  }
+  return sum / weight;
+}
+
+double Contour::sweep(std::size_t i) const {
+  if (segments[i] == Segment::Line || segments[i] == Segment::Cubic) {
+    return 0;
+  }
+  const auto a = start(i) - centers[i];
+  const auto b = end(i) - centers[i];
+  // angle from a to b, counterclockwise, in [0, 2π)
+  double angle = std::atan2(a.Crossed(b), a.Dot(b));
+  if (angle < 0) {
+    angle += 2 * M_PI;
+  }
+  return segments[i] == Segment::ArcCCW ? angle : angle - 2 * M_PI;
+}
+
+double Contour::length(std::size_t i) const {
+  if (segments[i] == Segment::Line) {
+    return (end(i) - start(i)).Modulus();
+  }
+  if (segments[i] == Segment::Cubic) {
+    auto polyline = std::vector<gp_XY>();
+    flatten(i, 1e-3, polyline);
+    double result = 0;
+    auto last = start(i);
+    for (const auto &p : polyline) {
+      result += (p - last).Modulus();
+      last = p;
+    }
+    return result;
+  }
+  return std::abs(sweep(i)) * (start(i) - centers[i]).Modulus();
+}
+
+double Contour::length() const {
+  double result = 0;
+  for (std::size_t i = 0; i < size(); ++i) {
+    result += length(i);
+  }
+  return result;
+}
+
+void Contour::flatten(std::size_t i, double tolerance, std::vector<gp_XY> &out) const {
+  if (segments[i] == Segment::Cubic) {
+    // appends the end point
+    subdivide(*this, i, 0, start(i), 1, end(i), tolerance, 0, out);
+    return;
+  } else if (segments[i] != Segment::Line) {
+    const auto a = start(i) - centers[i];
+    const double radius = a.Modulus();
+    const double angle = sweep(i);
+    // the sagitta of a chord spanning an angle t is r * (1 - cos(t / 2))
+    const double max_step =
+        tolerance < radius ? 2 * std::acos(1 - tolerance / radius) : M_PI / 2;
+    const int n = std::max(1, static_cast<int>(std::ceil(std::abs(angle) / max_step)));
+    for (int k = 1; k < n; ++k) {
+      const double t = angle * k / n;
+      const double c = std::cos(t), s = std::sin(t);
+      out.push_back(centers[i] + gp_XY(a.X() * c - a.Y() * s, a.X() * s + a.Y() * c));
+    }
+  }
+  out.push_back(end(i));
+}
+
+std::vector<gp_XY> Contour::flatten(double tolerance) const {
+  auto result = std::vector<gp_XY>();
+  if (points.empty()) {
+    return result;
+  }
+  result.reserve(points.size());
+  result.push_back(points.front());
+  for (std::size_t i = 0; i < size(); ++i) {
+    flatten(i, tolerance, result);
+  }
+  return result;
+}
+
+} // namespace sse
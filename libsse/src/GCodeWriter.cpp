@@ -25,31 +25,133 @@
 
 #include <sse/GCodeWriter.hpp>
 
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
 namespace sse {
 
-GCodeWriter::GCodeWriter() : config(sse::Settings::getInstance()) {
+GCodeWriter::GCodeWriter(const Settings &settings)
+    : config(settings), options(compile_options()), tool(compile_extruder(extruder)) {
   data = std::string();
   // reserve a large buffer upfront
   data.reserve(INITIAL_GCODE_SIZE);
 }
 
-void GCodeWriter::create_header() {
-  // a list of settings to include in the comment header
-  auto settings_list = std::vector{"printer name", "layer_height"};
+GCodeWriter::GCodeWriter(const Settings &settings, const State &state)
+    : config(settings), position(state.position), extruder(state.extruder),
+      retracted(state.retracted), options(compile_options()),
+      tool(compile_extruder(extruder)) {
+  // parts of a program are small, and there may be many of them at once: no
+  // upfront buffer
+}
+
+GCodeWriter::Options GCodeWriter::compile_options() const {
+  auto result = Options();
+  result.tolerance = config.get_setting_fallback<double>("tolerance", result.tolerance);
+  result.min_segment_length =
+      config.get_setting_fallback<double>("min_segment_length", result.min_segment_length);
+  // exact arcs are much shorter programs, unless the controller lacks G2/G3
+  result.arc_moves = config.get_setting_fallback<bool>("arc_moves", result.arc_moves);
+  // cubic splines: "none", "G5" (Bezier, polynomial only) or "G5.2" (NURBS)
+  const auto splines = config.get_setting_fallback<std::string>("spline_moves", "none");
+  if (splines == "G5") {
+    result.splines = Options::Splines::Bezier;
+  } else if (splines == "G5.2") {
+    result.splines = Options::Splines::Nurbs;
+  }
+  return result;
+}
+
+GCodeWriter::ExtruderSettings GCodeWriter::compile_extruder(int n) const {
+  const auto table = fmt::format("printer.extruder_{}.", n);
+  auto result = ExtruderSettings();
+  result.feedrate = config.get_setting_fallback<double>(table + "extrusion_speed", 60.0) * 60;
+  result.retraction_feedrate =
+      config.get_setting_fallback<double>(table + "retraction_speed", 0.0) * 60;
+  result.retraction = config.get_setting_fallback<double>(table + "retraction_distance", 0.0);
+  return result;
+}
+
+GCodeWriter::State GCodeWriter::get_state() const {
+  auto result = State();
+  result.position = position;
+  result.extruder = extruder;
+  result.retracted = retracted;
+  return result;
+}
+
+void GCodeWriter::write(int fd, const std::vector<std::string> &chunks) {
+  // at most IOV_MAX buffers per call
+  const auto max = static_cast<std::size_t>(std::max(1L, ::sysconf(_SC_IOV_MAX)));
+  auto buffers = std::vector<iovec>();
+  for (const auto &c : chunks) {
+    if (!c.empty()) {
+      buffers.push_back(iovec{const_cast<char *>(c.data()), c.size()});
+    }
+  }
+  std::size_t first = 0;
+  while (first < buffers.size()) {
+    const auto count = std::min(max, buffers.size() - first);
+    const auto n = ::writev(fd, &buffers[first], static_cast<int>(count));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("GCodeWriter: write failed: ") + std::strerror(errno));
+    }
+    // skip what was written, possibly part of a buffer
+    auto written = static_cast<std::size_t>(n);
+    while (written > 0 && written >= buffers[first].iov_len) {
+      written -= buffers[first].iov_len;
+      ++first;
+    }
+    if (written > 0) {
+      buffers[first].iov_base = static_cast<char *>(buffers[first].iov_base) + written;
+      buffers[first].iov_len -= written;
+    }
+  }
+}
 
-  // get the current date and time
+void GCodeWriter::write(const std::filesystem::path &file, const std::vector<std::string> &chunks) {
+  const int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("GCodeWriter: can't open " + file.string() + ": " +
+                             std::strerror(errno));
+  }
+  try {
+    write(fd, chunks);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  if (::close(fd) < 0) {
+    throw std::runtime_error("GCodeWriter: can't write " + file.string() + ": " +
+                             std::strerror(errno));
+  }
+}
+
+void GCodeWriter::create_header() {
+  // get the current date and time; jobs may run concurrently, so not ctime()
   auto now =
       std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  std::tm local{};
+  char date[32] = "";
+  if (::localtime_r(&now, &local) != nullptr) {
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &local);
+  }
   // first line of gcode program contains meta-information
-  add_comment(
-      fmt::format("Sliced by StepSlicerEngine on {0}", std::ctime(&now)));
+  add_comment(fmt::format("Sliced by StepSlicerEngine on {}", date));
+  add_comment(fmt::format("printer: {}",
+                          config.get_setting_fallback<std::string>("printer.name", "unknown")));
 
-  // FIXME
-  for (auto s : settings_list) {
-    // format settings: "key = value"
-    // 10 digit precision, force inlining
-    add_comment(toml::format(toml::find(config.config, s), 0, 10, true, true));
-  }
+  // millimeters, absolute positions, relative extrusion: every E value is the
+  // filament fed by one move, whatever the firmware defaults to
+  data.append("G21\nG90\nM83\n");
 }
 
 void GCodeWriter::add_rapid(double x, double y, double z) {
@@ -62,128 +164,236 @@ std::string GCodeWriter::add_rapid(const gp_Pnt destination) {
   return fmt::format("G0 X{} Y{} Z{}", destination.X(), destination.Y(), destination.Z());
 }
 
-std::string GCodeWriter::add_line(Geom_Line c) {
-  // get settings
-  auto feedrate = config.get_setting<uint>("E0.print_speed");
-  auto a = c.Value(c.FirstParameter());
-  double x, y, z;
-  a.Coord(x, y, z);
-
-  auto b = c.Value(c.LastParameter());
-  b.Coord(x, y, z);
-
-  // calculate line distance
-  auto distance = a.Distance(b);
-
-  std::string move =
-      fmt::format("G1 X{} Y{} Z{} E{} F{}\n;", x, y, z, distance, feedrate);
-
+std::string GCodeWriter::add_arc(const gp_XY &end, const gp_XY &center, bool ccw,
+                                 double length, double feedrate) {
+  // I,J are relative to the start of the arc
+  const auto offset = center - position.XY();
+  auto move = fmt::format("{} X{:.3f} Y{:.3f} I{:.3f} J{:.3f} E{:.5f} F{:.0f}\n",
+                          ccw ? "G3" : "G2", end.X(), end.Y(), offset.X(),
+                          offset.Y(), length, feedrate);
+  data.append(move);
+  position.SetCoord(end.X(), end.Y(), position.Z());
   return move;
 }
 
-std::string GCodeWriter::add_line(Handle(Geom_Line) l) {
-
-  auto start = l->Value(l->FirstParameter());
-  auto end = l->Value(l->LastParameter());
-
-  auto distance = end.Distance(start);
-
-  auto feedrate = config.get_setting<uint>("E0.print_speed");
-
-  return fmt::format("G1 X{} Y{} Z{} E{} F{}\n", end.X(), end.Y(), end.Z(), distance, feedrate);
+std::string GCodeWriter::add_bezier(const gp_XY &end, const Contour::Cubic &c,
+                                    double length, double feedrate) {
+  // I,J: first control point, relative to the start; P,Q: second control point,
+  // relative to the end
+  const auto first = c.controls[0] - position.XY();
+  const auto second = c.controls[1] - end;
+  auto move = fmt::format(
+      "G5 X{:.3f} Y{:.3f} I{:.3f} J{:.3f} P{:.3f} Q{:.3f} E{:.5f} F{:.0f}\n", end.X(),
+      end.Y(), first.X(), first.Y(), second.X(), second.Y(), length, feedrate);
+  data.append(move);
+  position.SetCoord(end.X(), end.Y(), position.Z());
+  return move;
 }
 
-std::string GCodeWriter::add_line(gp_Lin l) { return ""; }
-
-std::string GCodeWriter::add_arc(Handle(Geom_Circle) c) {
-  // TODO: figure out whether CW or CCW
-  std::string move = fmt::format("G2 X{} Y{} Z{} I{} J{} P{} E{}\n");
+std::string GCodeWriter::add_nurbs(const gp_XY &end, const Contour::Cubic &c,
+                                   double length, double feedrate) {
+  // the block lists every control point, starting with the current position,
+  // with its weight; L is the order, i.e. degree + 1
+  auto move = fmt::format("G5.2 X{:.3f} Y{:.3f} P{:.5f} L4 E{:.5f} F{:.0f}\n",
+                          position.X(), position.Y(), c.weights[0], length, feedrate);
+  for (int k = 0; k < 2; ++k) {
+    move += fmt::format("X{:.3f} Y{:.3f} P{:.5f}\n", c.controls[k].X(),
+                        c.controls[k].Y(), c.weights[k + 1]);
+  }
+  move += fmt::format("X{:.3f} Y{:.3f} P{:.5f}\nG5.3\n", end.X(), end.Y(), c.weights[3]);
+  data.append(move);
+  position.SetCoord(end.X(), end.Y(), position.Z());
   return move;
 }
 
-void GCodeWriter::add_nurbs() {}
+std::string GCodeWriter::add_edge(const TopoDS_Edge &e) {
+  // the contour keeps the bounds and orientation of the edge, and splits
+  // curves into arcs and cubic Bezier segments
+  const double tolerance = options.tolerance;
+  const auto begin = data.size();
+  add_contour(Contour::from_wire(BRepBuilderAPI_MakeWire(e).Wire(), tolerance), tolerance);
+  return data.substr(begin);
+}
+
+std::string GCodeWriter::add_bspline(Handle(Geom_BoundedCurve) c) {
+  return add_edge(BRepBuilderAPI_MakeEdge(c).Edge());
+}
 
-void GCodeWriter::add_bezier(Geom_BezierCurve b) {}
+void GCodeWriter::add_wire(TopoDS_Wire w) {
+  // planar wire: keeps its arcs and splines, depending on the settings
+  const double tolerance = options.tolerance;
+  add_contour(Contour::from_wire(w, tolerance), tolerance);
+}
 
-void GCodeWriter::add_bslpine(Geom_BSplineCurve b) {
-  for(auto i = 0; i < b.NbPoles(); ++i) {
-      auto a = b.Pole(i);
+void GCodeWriter::line_to(const gp_XYZ &p, double feedrate, double min_length,
+                          double tolerance) {
+  const double distance = (p - position).Modulus();
+  // skip the shared vertex between edges
+  if (distance < Precision::Confusion()) {
+    return;
+  }
+  // merging must not cut the detail of the skipped points, e.g. a sharp corner:
+  // if one of them is too far from the merged move, end the move on the last
+  const auto chord = p - position;
+  for (const auto &s : skipped) {
+    const double t = std::clamp((s - position).Dot(chord) / chord.SquareModulus(), 0.0, 1.0);
+    if ((s - (position + chord * t)).Modulus() > tolerance) {
+      flush(feedrate);
+      line_to(p, feedrate, min_length, tolerance);
+      return;
     }
+  }
+  if (distance < min_length) {
+    skipped.push_back(p);
+    return;
+  }
+  // Z only when it changes, i.e. on non-planar paths
+  const auto z = std::abs(p.Z() - position.Z()) < Precision::Confusion()
+                     ? std::string()
+                     : fmt::format(" Z{:.3f}", p.Z());
+  data.append(fmt::format("G1 X{:.3f} Y{:.3f}{} E{:.5f} F{:.0f}\n", p.X(), p.Y(), z,
+                          distance, feedrate));
+  position = p;
+  skipped.clear();
+}
 
-
+void GCodeWriter::flush(double feedrate) {
+  if (!skipped.empty()) {
+    const auto p = skipped.back();
+    skipped.clear();
+    line_to(p, feedrate, 0, 0);
+  }
 }
 
-void GCodeWriter::add_wire(TopoDS_Wire w) {
-  // explore the wire
-  auto a = BRep_Tool();
+void GCodeWriter::add_path(const TopoDS_Wire &w, double tolerance) {
+  const double feedrate = tool.feedrate;
+  const double min_length = options.min_segment_length;
+  bool first = true;
+  // the explorer follows the connectivity of the wire
   for (BRepTools_WireExplorer we(w); we.More(); we.Next()) {
-    // get current edge
-    auto &edge = we.Current();
-    Standard_Real u_min, u_max;
-    // get handle to unbounded curve
-    // auto curve = BRepAdaptor_Curve(edge);
-    auto curve = BRep_Tool::Curve(edge, u_min, u_max);
-    // trim curve
-    auto z = Geom_TrimmedCurve(curve, u_min, u_max);
-    // auto a = Handle(Geom_Line)::DownCast(z);
-    // z->IsKind() == STANDARD_TYPE(Geom_Line);
-    // process curve
-    add_segment(curve);
+    const auto &edge = we.Current();
+    auto curve = BRepAdaptor_Curve(edge);
+    // discretize the edge, in the direction of the wire
+    auto points = GCPnts_QuasiUniformDeflection(curve, tolerance);
+    const int n = points.NbPoints();
+    const bool reversed = edge.Orientation() == TopAbs_REVERSED;
+    for (int i = 1; i <= n; ++i) {
+      const auto p = points.Value(reversed ? n + 1 - i : i);
+      // move to the start of the path
+      if (first) {
+        travel_to(p.XYZ());
+        first = false;
+        continue;
+      }
+      line_to(p.XYZ(), feedrate, min_length, tolerance);
+    }
+  }
+  // always end on the end of the path
+  flush(feedrate);
+}
+
+void GCodeWriter::add_contour(const Contour &c, double tolerance) {
+  if (c.empty()) {
+    return;
   }
+  const double feedrate = tool.feedrate;
+  const bool arcs = options.arc_moves;
+  const auto splines = options.splines;
+  const double min_length = options.min_segment_length;
+  const auto &start = c.points.front();
+  // nothing to do when continuing from the current position, e.g. a single curve
+  travel_to(gp_XYZ(start.X(), start.Y(), c.z));
+  auto points = std::vector<gp_XY>();
+  for (std::size_t i = 0; i < c.size(); ++i) {
+    const auto type = c.segments[i];
+    const bool arc = type == Contour::Segment::ArcCW || type == Contour::Segment::ArcCCW;
+    const bool cubic = type == Contour::Segment::Cubic;
+    if ((arc && arcs) || (cubic && splines == Options::Splines::Nurbs) ||
+        (cubic && splines == Options::Splines::Bezier && !c.cubic(i).rational())) {
+      // native moves start exactly on the end of the previous segment
+      flush(feedrate);
+      if (arc) {
+        add_arc(c.end(i), c.centers[i], type == Contour::Segment::ArcCCW, c.length(i),
+                feedrate);
+      } else if (splines == Options::Splines::Nurbs) {
+        add_nurbs(c.end(i), c.cubic(i), c.length(i), feedrate);
+      } else {
+        add_bezier(c.end(i), c.cubic(i), c.length(i), feedrate);
+      }
+      continue;
+    }
+    points.clear();
+    c.flatten(i, tolerance, points);
+    for (const auto &p : points) {
+      line_to(gp_XYZ(p.X(), p.Y(), c.z), feedrate, min_length, tolerance);
+    }
+  }
+  flush(feedrate);
 }
 
 std::string GCodeWriter::add_segment(Handle(Geom_Curve) c) {
-  // get settings
-  auto feedrate = config.get_setting<uint>("E0.print_speed");
-
-  if (c->IsKind(STANDARD_TYPE(Geom_Line))) {
-
-    auto t = Handle(Geom_Line)::DownCast(c);
-    return add_line(t);
-  } else if (c->IsKind(STANDARD_TYPE(Geom_Circle))) {
-    auto t = Handle(Geom_Circle)::DownCast(c);
-    return add_arc(t);
-  } else if (c->IsKind(STANDARD_TYPE(Geom_BezierCurve))) {
-    auto t = Handle(Geom_BezierCurve)::DownCast(c);
-  } else if (c->IsKind(STANDARD_TYPE(Geom_BSplineCurve))) {
-    auto t = Handle(Geom_BSplineCurve)::DownCast(c);
-  } else {
-    throw new std::runtime_error(
-        fmt::format("GCodeWriter: Invalid edge type: {}", c->get_type_name()));
+  auto edge = BRepBuilderAPI_MakeEdge(c);
+  if (!edge.IsDone()) {
+    throw std::runtime_error(
+        fmt::format("GCodeWriter: unbounded curve: {}", c->DynamicType()->Name()));
   }
+  return add_edge(edge.Edge());
+}
 
-  /*
-  switch (c.GetType()) {
-  case GeomAbs_Line:
-    return add_line(c.Line());
-  case GeomAbs_Circle:
+void GCodeWriter::retract(double distance) {
+  // E is relative, so a retraction is a single move, with no reset
+  const double speed = tool.retraction_feedrate;
+  if (speed > 0) {
+    data.append(fmt::format("G1 E{:.5f} F{:.0f}\n", -distance, speed));
+  } else {
+    data.append(fmt::format("G1 E{:.5f}\n", -distance));
+  }
+}
 
-    return add_arc(c);
-  case GeomAbs_Ellipse:
-    break;
-/*
-  case GeomAbs_NonUniform:
-    return "G5.2";
-    break;
+void GCodeWriter::unretract(double distance) { retract(-distance); }
 
-  case GeomAbs_BezierCurve:
-    // split curve
-    return add_bezier(c);
-  case GeomAbs_BSplineCurve:
-    // split spline
-    return add_bspline(c);
-  default:
-    throw new std::runtime_error("GCodeWriter: Invalid segment type");
-    break;
+void GCodeWriter::set_extruder(int n) {
+  if (n == extruder) {
+    return;
+  }
+  // the idle extruder stays retracted until it's selected again
+  const double retraction = tool.retraction;
+  if (retraction > 0) {
+    retract(retraction);
+    retracted[extruder] += retraction;
+  }
+  extruder = n;
+  tool = compile_extruder(n);
+  data.append(fmt::format("T{}\n", n - 1));
+  if (retracted[extruder] > 0) {
+    unretract(retracted[extruder]);
+    retracted[extruder] = 0;
   }
-  */
 }
 
-void GCodeWriter::retract(double distance) {
-  auto retraction_speed = config.get_setting<uint>("E0.retraction_speed");
-  std::string move = fmt::format("G92 E0;\nG1 E{} F{};\nG92 E0;\n", distance,
-                                 retraction_speed);
-  data.append(move);
+void GCodeWriter::travel_to(const gp_XYZ &p) {
+  if (position.IsEqual(p, Precision::Confusion())) {
+    return;
+  }
+  auto path = std::vector<gp_XY>();
+  // combing: within a layer, stay inside the region, without retracting
+  if (planner && std::abs(p.Z() - position.Z()) < Precision::Confusion() &&
+      planner->route(position.XY(), p.XY(), path)) {
+    for (const auto &q : path) {
+      data.append(fmt::format("G0 X{:.3f} Y{:.3f}\n", q.X(), q.Y()));
+    }
+    position = p;
+    return;
+  }
+  const double retraction = tool.retraction;
+  if (retraction > 0) {
+    retract(retraction);
+  }
+  data.append(fmt::format("G0 X{:.3f} Y{:.3f} Z{:.3f}\n", p.X(), p.Y(), p.Z()));
+  if (retraction > 0) {
+    unretract(retraction);
+  }
+  position = p;
 }
 
 } // namespace sse
@@ -0,0 +1,125 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ImportCache.cpp
+ * @brief Imported shapes and parsed profiles, shared between jobs
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/ImportCache.hpp>
+
+namespace sse {
+
+namespace {
+
+// the OCCT STEP and IGES readers share global state, one import at a time
+std::mutex import_mutex;
+
+} // namespace
+
+ImportCache::Key ImportCache::key(const fs::path &file) {
+  if (!fs::exists(file)) {
+    throw std::runtime_error("Error, file does not exist: " + file.string());
+  }
+  return Key(fs::weakly_canonical(file).string(), fs::last_write_time(file));
+}
+
+template <typename T> void ImportCache::evict(std::map<Key, Entry<T>> &cache, const Key &key) {
+  // the versions of a file are adjacent, ordered by path first
+  auto it = cache.lower_bound(Key(key.first, fs::file_time_type::min()));
+  while (it != cache.end() && it->first.first == key.first) {
+    it = cache.erase(it);
+  }
+  while (cache.size() >= capacity) {
+    const auto oldest =
+        std::min_element(cache.begin(), cache.end(), [](const auto &a, const auto &b) {
+          return a.second.used < b.second.used;
+        });
+    // jobs waiting on an entry being loaded keep their own future
+    cache.erase(oldest);
+  }
+}
+
+template <typename T, typename F>
+T ImportCache::lookup(std::map<Key, Entry<T>> &cache, const Key &key, F load) {
+  auto promise = std::promise<T>();
+  auto future = std::shared_future<T>();
+  bool owner = false;
+  {
+    const std::lock_guard<std::mutex> lock(mutex);
+    const auto it = cache.find(key);
+    if (it != cache.end()) {
+      it->second.used = ++tick;
+      future = it->second.value;
+    } else {
+      evict(cache, key);
+      future = promise.get_future().share();
+      cache.emplace(key, Entry<T>{future, ++tick});
+      owner = true;
+    }
+  }
+  // load outside the lock, other files can be loaded meanwhile
+  if (owner) {
+    try {
+      promise.set_value(load());
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+      const std::lock_guard<std::mutex> lock(mutex);
+      cache.erase(key);
+    }
+  }
+  return future.get();
+}
+
+TopoDS_Shape ImportCache::shape(const std::string &file) {
+  const auto shape = lookup(shapes, key(file), [&]() {
+    const std::lock_guard<std::mutex> lock(import_mutex);
+    spdlog::debug("importing {}", file);
+    {
+      const std::lock_guard<std::mutex> count_lock(mutex);
+      ++count;
+    }
+    return Importer().import(file);
+  });
+  // jobs move and mesh their objects, which must not touch the cached shape
+  return BRepBuilderAPI_Copy(shape).Shape();
+}
+
+Settings ImportCache::settings(const fs::path &profile) {
+  return lookup(profiles, key(profile), [&]() { return Settings(profile); });
+}
+
+std::size_t ImportCache::imports() const {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return count;
+}
+
+std::size_t ImportCache::size() const {
+  const std::lock_guard<std::mutex> lock(mutex);
+  return shapes.size() + profiles.size();
+}
+
+void ImportCache::clear() {
+  const std::lock_guard<std::mutex> lock(mutex);
+  shapes.clear();
+  profiles.clear();
+}
+
+} // namespace sse
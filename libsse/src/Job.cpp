@@ -0,0 +1,116 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Job.cpp
+ * @brief A slicing job: files, profile and options, to a G-code program
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/Job.hpp>
+
+namespace sse {
+
+JobDescription JobDescription::from_toml(const toml::value &table) {
+  auto result = JobDescription();
+  const auto files = Settings::find_setting<std::vector<std::string>>(table, "files");
+  if (!files || files->empty()) {
+    throw std::runtime_error("Job: no files provided");
+  }
+  result.files = *files;
+  const auto profile = Settings::find_setting<std::string>(table, "profile");
+  if (!profile) {
+    throw std::runtime_error("Job: no profile provided");
+  }
+  result.profile = *profile;
+  result.extruders =
+      Settings::find_setting<std::vector<int>>(table, "extruders").value_or(std::vector<int>());
+  if (const auto overrides = Settings::find_setting<toml::table>(table, "overrides")) {
+    result.overrides = *overrides;
+  }
+  result.autoorient = Settings::find_setting<bool>(table, "autoorient").value_or(false);
+  result.autoplace = Settings::find_setting<bool>(table, "autoplace").value_or(false);
+  result.spiral = Settings::find_setting<bool>(table, "spiral").value_or(false);
+  result.nonplanar = Settings::find_setting<bool>(table, "nonplanar").value_or(false);
+  return result;
+}
+
+Job::Job(JobDescription description, ImportCache &cache,
+         std::shared_ptr<spdlog::logger> logger)
+    : description(std::move(description)), cache(cache), logger(std::move(logger)) {}
+
+std::vector<std::string> Job::run() {
+  auto settings = cache.settings(description.profile);
+  settings.merge(description.overrides);
+  auto slicer = Slicer(std::move(settings), logger);
+
+  auto objects = std::vector<std::shared_ptr<Object>>();
+  auto failures = std::vector<std::string>();
+  for (std::size_t i = 0; i < description.files.size(); ++i) {
+    const auto &f = description.files[i];
+    logger->info("Loading file: {}", f);
+    try {
+      auto object = std::make_shared<Object>(cache.shape(f), f);
+      // per-object settings and modifiers from the profile
+      slicer.load_object_settings(*object, cache);
+      // files without an extruder are printed by the first one
+      if (i < description.extruders.size()) {
+        object->set_extruder(description.extruders[i]);
+      }
+      objects.push_back(std::move(object));
+    } catch (const std::runtime_error &e) {
+      // report every file that failed, not only the first one
+      logger->error(e.what());
+      failures.push_back(f + ": " + e.what());
+    }
+  }
+  // a plate missing a part, or a modifier, isn't the plate that was asked for
+  if (!failures.empty()) {
+    auto message = std::string("Job: ") + std::to_string(failures.size()) + " of " +
+                   std::to_string(description.files.size()) + " files could not be loaded";
+    for (const auto &f : failures) {
+      message += "; " + f;
+    }
+    throw std::runtime_error(message);
+  }
+
+  // auto orient objects, before arranging their footprints
+  if (description.autoorient) {
+    slicer.orient_objects(objects);
+  }
+  if (description.autoplace) {
+    slicer.arrange_objects(objects);
+  }
+
+  // spiral and non-planar modes produce toolpaths directly
+  if (description.spiral || description.nonplanar) {
+    auto layers = std::vector<SurfaceLayer>();
+    if (description.spiral) {
+      // a single layer, made of one continuous path per object
+      layers.push_back(SurfaceLayer{0.0, slicer.slice_spiral(objects)});
+    } else {
+      layers = slicer.slice_surfaces(objects);
+    }
+    return {slicer.generate_toolpaths(layers)};
+  }
+  const auto slices = slicer.slice(objects);
+  return slicer.generate_gcode(slices);
+}
+
+} // namespace sse
@@ -0,0 +1,357 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Nester.cpp
+ * @brief Nests objects on the build plate, based on their real outline
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/Nester.hpp>
+
+namespace sse {
+
+Nester::Nester(std::vector<std::shared_ptr<Object>> objects, double plate_x,
+               double plate_y, double spacing, double resolution,
+               bool circular)
+    : objects(objects), spacing(spacing), resolution(resolution),
+      circular(circular) {
+  // check for empty vector
+  if (objects.empty()) {
+    throw std::runtime_error("Nester: no objects to nest");
+  }
+  if (resolution <= 0 || spacing < 0) {
+    throw std::runtime_error("Nester: invalid resolution or spacing");
+  }
+  for (const auto &o : objects) {
+    if (o->get_bound_box().IsVoid()) {
+      throw std::runtime_error("Nester: object is empty");
+    }
+  }
+
+  plate_width = static_cast<int>(std::floor(plate_x / resolution));
+  plate_length = static_cast<int>(std::floor(plate_y / resolution));
+  plate.assign(static_cast<std::size_t>(plate_width) * plate_length, 0);
+  prefix.assign(static_cast<std::size_t>(plate_width + 1) * plate_length, 0);
+
+  // block every cell that isn't entirely inside the circle
+  if (circular) {
+    const double radius = std::min(plate_x, plate_y) / 2;
+    const auto center = gp_XY(plate_x / 2, plate_y / 2);
+    auto inside = [&](double x, double y) {
+      return (gp_XY(x, y) - center).SquareModulus() <= radius * radius;
+    };
+    for (int j = 0; j < plate_length; ++j) {
+      for (int i = 0; i < plate_width; ++i) {
+        const double x0 = i * resolution, x1 = (i + 1) * resolution;
+        const double y0 = j * resolution, y1 = (j + 1) * resolution;
+        if (!(inside(x0, y0) && inside(x1, y0) && inside(x0, y1) && inside(x1, y1))) {
+          plate[static_cast<std::size_t>(j) * plate_width + i] = 1;
+        }
+      }
+    }
+    // a footprint that covers the whole plate rebuilds every row
+    auto all = Footprint();
+    all.length = plate_length;
+    occupy(all, 0, 0);
+  }
+
+  // meshing isn't safe to run concurrently on shapes that share geometry, so
+  // triangulate sequentially
+  spdlog::debug("Nester: triangulating objects");
+  auto meshes = std::vector<std::vector<std::array<gp_Pnt, 3>>>();
+  for (const auto &o : objects) {
+    meshes.push_back(o->triangulate(resolution / 2));
+  }
+
+  // rasterize each object in all four orientations
+  spdlog::debug("Nester: rasterizing footprints");
+  footprints.resize(objects.size());
+  OSD_Parallel::For(0, static_cast<int>(objects.size()), [&](const int i) {
+    const auto center = objects[i]->center_point();
+    for (int k = 0; k < 4; ++k) {
+      footprints[i][k] = rasterize(meshes[i], gp_XY(center.X(), center.Y()), k);
+    }
+  });
+}
+
+Nester::Footprint
+Nester::rasterize(const std::vector<std::array<gp_Pnt, 3>> &triangles,
+                  const gp_XY &center, int quarter_turns) const {
+  auto result = Footprint();
+  result.quarter_turns = quarter_turns;
+  result.center = center;
+
+  // rotate a point about the center, counterclockwise
+  auto rotate = [&](const gp_Pnt &p) {
+    const auto d = gp_XY(p.X(), p.Y()) - center;
+    switch (quarter_turns) {
+      case 1:
+        return center + gp_XY(-d.Y(), d.X());
+      case 2:
+        return center - d;
+      case 3:
+        return center + gp_XY(d.Y(), -d.X());
+      default:
+        return center + d;
+    }
+  };
+
+  // project the mesh onto the XY plane
+  auto projected = std::vector<std::array<gp_XY, 3>>();
+  projected.reserve(triangles.size());
+  double xmin = RealLast(), ymin = RealLast();
+  double xmax = RealFirst(), ymax = RealFirst();
+  for (const auto &t : triangles) {
+    auto p = std::array<gp_XY, 3>{rotate(t[0]), rotate(t[1]), rotate(t[2])};
+    for (const auto &v : p) {
+      xmin = std::min(xmin, v.X());
+      ymin = std::min(ymin, v.Y());
+      xmax = std::max(xmax, v.X());
+      ymax = std::max(ymax, v.Y());
+    }
+    projected.push_back(p);
+  }
+
+  // each object is expanded by half the spacing, plus one cell to make up for
+  // rounding
+  const int pad = static_cast<int>(std::ceil(spacing / 2 / resolution)) + 1;
+  result.origin = gp_XY(xmin - pad * resolution, ymin - pad * resolution);
+  result.width = static_cast<int>(std::ceil((xmax - xmin) / resolution)) + 1 + 2 * pad;
+  result.length = static_cast<int>(std::ceil((ymax - ymin) / resolution)) + 1 + 2 * pad;
+
+  auto raster = std::vector<std::uint8_t>(
+      static_cast<std::size_t>(result.width) * result.length, 0);
+  auto cell = [&](double x, double y) {
+    return std::make_pair(
+        static_cast<int>(std::floor((x - result.origin.X()) / resolution)),
+        static_cast<int>(std::floor((y - result.origin.Y()) / resolution)));
+  };
+
+  for (const auto &t : projected) {
+    // always mark the vertices, so that slivers (e.g. vertical faces) aren't lost
+    for (const auto &v : t) {
+      auto [i, j] = cell(v.X(), v.Y());
+      raster[j * result.width + i] = 1;
+    }
+    // signed area; skip degenerate triangles
+    const double area = (t[1] - t[0]) ^ (t[2] - t[0]);
+    if (std::abs(area) < Precision::Confusion()) {
+      continue;
+    }
+    // test the center of every cell in the bounding box of the triangle
+    auto [i0, j0] = cell(std::min({t[0].X(), t[1].X(), t[2].X()}),
+                         std::min({t[0].Y(), t[1].Y(), t[2].Y()}));
+    auto [i1, j1] = cell(std::max({t[0].X(), t[1].X(), t[2].X()}),
+                         std::max({t[0].Y(), t[1].Y(), t[2].Y()}));
+    for (int j = j0; j <= j1; ++j) {
+      for (int i = i0; i <= i1; ++i) {
+        const auto p = result.origin + gp_XY((i + 0.5) * resolution, (j + 0.5) * resolution);
+        // edge functions all have the same sign as the area if p is inside
+        const double e0 = (t[1] - t[0]) ^ (p - t[0]);
+        const double e1 = (t[2] - t[1]) ^ (p - t[1]);
+        const double e2 = (t[0] - t[2]) ^ (p - t[2]);
+        if (area > 0 ? (e0 >= 0 && e1 >= 0 && e2 >= 0)
+                     : (e0 <= 0 && e1 <= 0 && e2 <= 0)) {
+          raster[j * result.width + i] = 1;
+        }
+      }
+    }
+  }
+
+  // dilate the silhouette by the padding radius, with a round brush
+  auto dilated = raster;
+  const int radius = pad - 1;
+  for (int j = 0; j < result.length; ++j) {
+    for (int i = 0; i < result.width; ++i) {
+      if (!raster[j * result.width + i]) {
+        continue;
+      }
+      for (int dj = -radius; dj <= radius; ++dj) {
+        for (int di = -radius; di <= radius; ++di) {
+          if (di * di + dj * dj <= radius * radius) {
+            dilated[(j + dj) * result.width + (i + di)] = 1;
+          }
+        }
+      }
+    }
+  }
+
+  // convert the raster into spans
+  for (int j = 0; j < result.length; ++j) {
+    for (int i = 0; i < result.width;) {
+      if (!dilated[j * result.width + i]) {
+        ++i;
+        continue;
+      }
+      const int begin = i;
+      while (i < result.width && dilated[j * result.width + i]) {
+        ++i;
+      }
+      result.spans.push_back({j, begin, i});
+      result.area += static_cast<std::size_t>(i - begin);
+    }
+  }
+
+  return result;
+}
+
+bool Nester::fits(const Footprint &f, int x, int y) const {
+  for (const auto &[row, begin, end] : f.spans) {
+    if (occupied(y + row, x + begin, x + end) > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double Nester::cost(const Footprint &f, int x, int y) const {
+  if (circular) {
+    const double dx = x + f.width / 2.0 - plate_width / 2.0;
+    const double dy = y + f.length / 2.0 - plate_length / 2.0;
+    return std::sqrt(dx * dx + dy * dy);
+  }
+  return static_cast<double>(y + f.length) * (plate_width + 1) + (x + f.width);
+}
+
+std::pair<int, int> Nester::search(const Footprint &f) const {
+  const int rows = plate_length - f.length + 1;
+  const int columns = plate_width - f.width + 1;
+  // footprint is bigger than the plate
+  if (rows <= 0 || columns <= 0) {
+    return {-1, -1};
+  }
+  // find the best position in every row, in parallel
+  auto best = std::vector<int>(rows, -1);
+  OSD_Parallel::For(0, rows, [&](const int y) {
+    for (int x = 0; x < columns; ++x) {
+      if (!fits(f, x, y)) {
+        continue;
+      }
+      // bottom-left: the left-most position is the best one
+      if (!circular) {
+        best[y] = x;
+        return;
+      }
+      // ring: keep the position closest to the center
+      if (best[y] < 0 || cost(f, x, y) < cost(f, best[y], y)) {
+        best[y] = x;
+      }
+    }
+  });
+  // pick the best row
+  auto result = std::make_pair(-1, -1);
+  for (int y = 0; y < rows; ++y) {
+    if (best[y] < 0) {
+      continue;
+    }
+    if (result.first < 0 || cost(f, best[y], y) < cost(f, result.first, result.second)) {
+      result = {best[y], y};
+    }
+    // bottom-most row wins
+    if (!circular) {
+      break;
+    }
+  }
+  return result;
+}
+
+void Nester::occupy(const Footprint &f, int x, int y) {
+  for (const auto &[row, begin, end] : f.spans) {
+    std::fill_n(plate.begin() + static_cast<std::size_t>(y + row) * plate_width + x + begin,
+                end - begin, 1);
+  }
+  // rebuild the prefix sums of the affected rows
+  for (int j = y; j < y + f.length; ++j) {
+    const auto *cells = &plate[static_cast<std::size_t>(j) * plate_width];
+    auto *sums = &prefix[static_cast<std::size_t>(j) * (plate_width + 1)];
+    for (int i = 0; i < plate_width; ++i) {
+      sums[i + 1] = sums[i] + cells[i];
+    }
+  }
+}
+
+void Nester::nest() {
+  spdlog::debug("Nester: nesting");
+  placements.clear();
+
+  // place the biggest objects first
+  auto order = std::vector<std::size_t>(objects.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+    return footprints[lhs][0].area > footprints[rhs][0].area;
+  });
+
+  for (auto i : order) {
+    auto best = Placement();
+    // try all orientations, keep the one which extends the nest the least
+    auto score = RealLast();
+    for (const auto &f : footprints[i]) {
+      auto [x, y] = search(f);
+      if (x < 0) {
+        continue;
+      }
+      auto s = cost(f, x, y);
+      if (s < score) {
+        score = s;
+        best = Placement{objects[i].get(), &f, x, y};
+      }
+    }
+    if (!best.object) {
+      spdlog::error("Nester: object doesn't fit on build plate");
+      throw std::runtime_error("Nester: object doesn't fit on build plate");
+    }
+    occupy(*best.footprint, best.x, best.y);
+    placements.push_back(best);
+  }
+}
+
+void Nester::arrange() const {
+  spdlog::debug("Nester: translating objects to new location");
+  if (placements.empty()) {
+    return;
+  }
+  // center the nest on the rectangular build plate
+  int xmin = plate_width, ymin = plate_length, xmax = 0, ymax = 0;
+  for (const auto &p : placements) {
+    xmin = std::min(xmin, p.x);
+    ymin = std::min(ymin, p.y);
+    xmax = std::max(xmax, p.x + p.footprint->width);
+    ymax = std::max(ymax, p.y + p.footprint->length);
+  }
+  // circular plates are already nested around the center
+  const int shift_x = circular ? 0 : (plate_width - (xmax - xmin)) / 2 - xmin;
+  const int shift_y = circular ? 0 : (plate_length - (ymax - ymin)) / 2 - ymin;
+
+  for (const auto &p : placements) {
+    const auto &f = *p.footprint;
+    if (f.quarter_turns != 0) {
+      p.object->rotate(gp_Ax1(gp_Pnt(f.center.X(), f.center.Y(), 0), gp::DZ()),
+                       90.0 * f.quarter_turns);
+    }
+    // move raster cell (0,0) to its position on the plate
+    const auto target = gp_XY((p.x + shift_x) * resolution, (p.y + shift_y) * resolution);
+    const auto delta = target - f.origin;
+    p.object->translate(delta.X(), delta.Y(), 0);
+  }
+}
+
+} // namespace sse
@@ -21,14 +21,15 @@
  * @brief
  * @author
  *
- * @bug TODO: consider changing transform to TopoDS_Shape.Location()
+ * Transformations are accumulated lazily. Rigid motions are applied as a
+ * TopoDS_Shape location, which doesn't touch the geometry.
  */
 
 #include <sse/Object.hpp>
 
 namespace sse {
 
-Object::Object(TopoDS_Shape &shape, const std::string &fname) : shape(std::make_unique<TopoDS_Shape>(shape)), filename(fname) {
+Object::Object(const TopoDS_Shape &shape, const std::string &fname) : shape(std::make_unique<TopoDS_Shape>(shape)), filename(fname) {
   spdlog::info("Initializing object with shape");
   // calculate the axis-aligned bounding box
   bounding_box = Bnd_Box();
@@ -36,24 +37,91 @@ Object::Object(TopoDS_Shape &shape, const std::string &fname) : shape(std::make_
   generate_bounds(false, 5);
 }
 
+namespace {
+
+/**
+ * @brief Check whether a transformation maps axis-aligned boxes onto
+ * axis-aligned boxes, i.e. translations, mirroring about the principal planes,
+ * and quarter turns
+ */
+bool axis_aligned(const gp_Trsf &t) {
+  // the vectorial part includes the scale factor
+  const auto m = t.VectorialPart();
+  const auto s = std::abs(t.ScaleFactor());
+  for (int i = 1; i <= 3; ++i) {
+    for (int j = 1; j <= 3; ++j) {
+      const auto v = std::abs(m(i, j));
+      if (v > Precision::Confusion() && std::abs(v - s) > Precision::Confusion()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Transform a box, enclosing the transformed corners
+ *
+ * Unlike Bnd_Box::Transformed, the gap isn't transformed along with the
+ * corners, so it doesn't grow with every rotation.
+ */
+Bnd_Box transformed(const Bnd_Box &box, const gp_Trsf &t) {
+  if (box.IsVoid()) {
+    return box;
+  }
+  if (box.IsOpenXmin() || box.IsOpenXmax() || box.IsOpenYmin() ||
+      box.IsOpenYmax() || box.IsOpenZmin() || box.IsOpenZmax()) {
+    return box.Transformed(t);
+  }
+  const auto gap = box.GetGap();
+  const auto min = box.CornerMin().XYZ() + gp_XYZ(gap, gap, gap);
+  const auto max = box.CornerMax().XYZ() - gp_XYZ(gap, gap, gap);
+  auto result = Bnd_Box();
+  for (int i = 0; i < 8; ++i) {
+    result.Add(gp_Pnt(i & 1 ? max.X() : min.X(), i & 2 ? max.Y() : min.Y(),
+                      i & 4 ? max.Z() : min.Z())
+                   .Transformed(t));
+  }
+  result.SetGap(gap);
+  return result;
+}
+
+} // namespace
+
 void Object::generate_bounds(bool optimal, double gap) {
-  spdlog::debug("generating bounding box");
-  // clear bounding box
-  bounding_box.SetVoid();
-  // create bounding box
-  // TODO: test perf of BRepBndLib::AddOptimal
-  if (optimal) {
-    BRepBndLib::AddOptimal(*shape, bounding_box);
-  } else {
-    BRepBndLib::Add(*shape, bounding_box);
+  // the cached bounds are reused if they belong to the current geometry, are
+  // at least as tight as requested, and are still exact after the
+  // transformations since
+  const bool valid = bounds && bounds->version == version &&
+                     (bounds->optimal || !optimal) && axis_aligned(bounds->trsf);
+  if (!valid) {
+    spdlog::debug("generating bounding box");
+    apply_transform();
+    auto box = Bnd_Box();
+    // create bounding box
+    // TODO: test perf of BRepBndLib::AddOptimal
+    if (optimal) {
+      BRepBndLib::AddOptimal(*shape, box);
+    } else {
+      BRepBndLib::Add(*shape, box);
+    }
+    bounds = Bounds{version, optimal, box, gp_Trsf()};
   }
 
+  bounding_box = transformed(bounds->box, bounds->trsf);
   // reset gap
   // TODO: configurable gap
   bounding_box.SetGap(gap);
+  update_footprint();
+}
+
+void Object::update_footprint() {
   spdlog::debug("generating footprint");
   // clear footprint
   footprint.SetVoid();
+  if (bounding_box.IsVoid()) {
+    return;
+  }
   // add corner points to footprint
   // unfortunately, I can't find an elegant way to convert gp_Pnt to gp_Pnt2d
 
@@ -61,7 +129,7 @@ void Object::generate_bounds(bool optimal, double gap) {
     footprint.Add(
         gp_Pnt2d(bounding_box.CornerMin().X(), bounding_box.CornerMin().Y()));
     footprint.Add(
-        gp_Pnt2d(bounding_box.CornerMax().X(), bounding_box.CornerMin().Y()));
+        gp_Pnt2d(bounding_box.CornerMax().X(), bounding_box.CornerMax().Y()));
   }  catch (Standard_ConstructionError &e) {
     spdlog::error(e.GetMessageString());
   }
@@ -99,20 +167,24 @@ void Object::lay_flat(const TopoDS_Face &face) {
   // TODO: better decision regarding tolerance
   if (!normal.IsOpposite(gp::DZ(), 0.0001)) {
     // the axis of rotation is the cross product of the two vectors
-    auto unit_vector = normal.Crossed(gp::DZ());
-    spdlog::debug("Axis: {:f},{:f},{:f}");
-    spdlog::debug("Angle: {:f}°");
+    // a normal along +Z has no unique axis, any horizontal one will do
+    auto unit_vector = normal.IsParallel(gp::DZ(), 0.0001)
+                           ? gp::DX()
+                           : normal.Crossed(gp::DZ());
+    auto angle = normal.Angle(gp::DZ()) + M_PI;
+    spdlog::debug("Axis: {:f},{:f},{:f}", unit_vector.X(), unit_vector.Y(),
+                  unit_vector.Z());
+    spdlog::debug("Angle: {:f}°", angle * 180 / M_PI);
     // rotate the object, so that the specified normal is opposite the +Z unit
     // vector
     // TODO: verify center point is correct/good idea
-    // TODO: verify angle calc correctness
-    rotate(gp_Ax1(center_point(), unit_vector), normal.Angle(gp::DZ()) + M_PI);
+    auto rotation = gp_Trsf();
+    rotation.SetRotation(gp_Ax1(center_point(), unit_vector), angle);
+    transform(rotation);
 
-    // if rotation happened, recalculate coordinate
-    // TODO: make more elegant
-    point = GeomLProp_SLProps(BRep_Tool::Surface(face), (umin + umax) / 2,
-                              (vmin + vmax) / 2, 1, 1e-6)
-                .Value();
+    // move the coordinate along with the object; the face itself belongs to the
+    // untransformed shape
+    point.Transform(rotation);
   }
 
   // move the shape so that the face is touching the XY plane
@@ -169,18 +241,130 @@ void Object::scale(const double x, const double y, const double z) {
 }
 
 void Object::transform(const gp_Trsf transform) {
+  // accumulate the transformation, applied after the pending ones
+  pending.PreMultiply(transform);
+  has_pending = true;
+  placement.PreMultiply(transform);
+  // update the cached mass properties in closed form
+  if (mass && mass->version == version) {
+    mass->volume *= std::pow(std::abs(transform.ScaleFactor()), 3);
+    mass->center.Transform(transform);
+  }
+  // the bounding box of the transformed box encloses the transformed shape;
+  // exact for translations, mirroring, and quarter turns
+  if (bounds) {
+    bounds->trsf.PreMultiply(transform);
+    const auto gap = bounding_box.GetGap();
+    bounding_box = transformed(bounds->box, bounds->trsf);
+    bounding_box.SetGap(gap);
+    update_footprint();
+  }
+}
+
+void Object::apply_transform() const {
+  if (!has_pending) {
+    return;
+  }
   try {
-    auto s = BRepBuilderAPI_Transform(*shape, transform).Shape();
-    shape = std::make_unique<TopoDS_Shape>(s);
+    // rigid motions only change the location of the shape, the geometry is
+    // shared with the original
+    if (!pending.IsNegative() &&
+        std::abs(pending.ScaleFactor() - 1.0) < Precision::Confusion()) {
+      shape->Move(TopLoc_Location(pending));
+    } else {
+      auto s = BRepBuilderAPI_Transform(*shape, pending, true).Shape();
+      shape = std::make_unique<TopoDS_Shape>(s);
+    }
   } catch (const StdFail_NotDone &e) {
     spdlog::error(e.GetMessageString());
   }
+  pending = gp_Trsf();
+  has_pending = false;
+}
+
+void Object::add_modifier(const TopoDS_Shape &volume, const toml::value &table) {
+  // kept where the object was loaded, get_modifiers() moves it along with
+  // the object
+  modifiers.push_back(Modifier{volume, table});
+}
+
+std::vector<Object::Modifier> Object::get_modifiers() const {
+  auto result = std::vector<Modifier>();
+  for (const auto &m : modifiers) {
+    // copy the geometry, the transformation may not be rigid
+    result.push_back(Modifier{BRepBuilderAPI_Transform(m.volume, placement, true).Shape(),
+                              m.overrides});
+  }
+  return result;
+}
+
+std::vector<std::array<gp_Pnt, 3>> Object::triangulate(double deflection) const {
+  spdlog::debug("triangulating object");
+  apply_transform();
+  // the mesh is stored in the faces of the shape, and only recomputed if
+  // the existing one is coarser than requested
+  auto mesher = BRepMesh_IncrementalMesh(*shape, deflection);
+  if (!mesher.IsDone()) {
+    spdlog::warn("object triangulation incomplete");
+  }
+
+  auto result = std::vector<std::array<gp_Pnt, 3>>();
+  for (TopExp_Explorer exp(*shape, TopAbs_FACE); exp.More(); exp.Next()) {
+    const auto &face = TopoDS::Face(exp.Current());
+    TopLoc_Location location;
+    auto triangulation = BRep_Tool::Triangulation(face, location);
+    // face couldn't be meshed, skip it
+    if (triangulation.IsNull()) {
+      continue;
+    }
+    const auto &trsf = location.Transformation();
+    const auto &nodes = triangulation->Nodes();
+    const auto &triangles = triangulation->Triangles();
+    for (auto i = triangles.Lower(); i <= triangles.Upper(); ++i) {
+      Standard_Integer n1, n2, n3;
+      triangles(i).Get(n1, n2, n3);
+      // keep the winding consistent with the face orientation
+      if (face.Orientation() == TopAbs_REVERSED) {
+        std::swap(n2, n3);
+      }
+      result.push_back({nodes(n1).Transformed(trsf), nodes(n2).Transformed(trsf),
+                        nodes(n3).Transformed(trsf)});
+    }
+  }
+  return result;
+}
+
+void Object::update_mass() const {
+  if (mass && mass->version == version) {
+    return;
+  }
+  spdlog::debug("computing mass properties");
+  GProp_GProps props;
+  BRepGProp::VolumeProperties(*shape, props);
+  // the shape may lag behind the pending transformation; rigid motions don't
+  // change the volume
+  mass = MassProperties{
+      version, props.Mass() * std::pow(std::abs(pending.ScaleFactor()), 3),
+      props.CentreOfMass().Transformed(pending)};
 }
 
 double Object::get_volume() const {
-  GProp_GProps volume;
-  BRepGProp::VolumeProperties(*shape, volume);
-  return volume.Mass();
+  update_mass();
+  return mass->volume;
+}
+
+gp_Pnt Object::center_of_mass() const {
+  update_mass();
+  return mass->center;
+}
+
+void Object::set_shape(const TopoDS_Shape &s) {
+  shape = std::make_unique<TopoDS_Shape>(s);
+  pending = gp_Trsf();
+  has_pending = false;
+  // invalidate all cached properties
+  ++version;
+  generate_bounds(false, bounding_box.GetGap());
 }
 
 } // namespace sse
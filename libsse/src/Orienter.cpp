@@ -0,0 +1,356 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file Orienter.cpp
+ * @brief Finds a good print orientation for an object
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/Orienter.hpp>
+
+namespace sse {
+
+// candidate directions closer than this are considered identical, in radians
+constexpr double DIRECTION_TOLERANCE = M_PI / 180;
+// maximum number of convex hull facets to consider
+constexpr std::size_t MAX_HULL_CANDIDATES = 64;
+
+Orienter::Orienter(Object &object, double layer_height, double overhang_angle,
+                   Weights weights)
+    : object(object), layer_height(layer_height),
+      overhang_limit(std::sin(overhang_angle * M_PI / 180)), weights(weights) {
+  if (layer_height <= 0) {
+    throw std::runtime_error("Orienter: invalid layer height");
+  }
+  center = object.center_point();
+  // precompute the normal and area of every triangle
+  for (const auto &t : object.triangulate(0.1)) {
+    const auto a = t[0].XYZ(), b = t[1].XYZ(), c = t[2].XYZ();
+    const auto n = (b - a) ^ (c - a);
+    const double m = n.Modulus();
+    // skip degenerate triangles
+    if (m < Precision::Confusion()) {
+      continue;
+    }
+    mesh.push_back(Triangle{{a, b, c}, n / m, m / 2});
+    area += m / 2;
+    for (const auto &v : {a, b, c}) {
+      diameter = std::max(diameter, 2 * (v - center.XYZ()).Modulus());
+    }
+  }
+  if (mesh.empty()) {
+    throw std::runtime_error("Orienter: object has no surface");
+  }
+}
+
+std::vector<Orienter::Candidate> Orienter::candidates() const {
+  auto directions = std::vector<gp_Dir>();
+  auto add = [&](const gp_Dir &d) {
+    for (const auto &e : directions) {
+      if (e.IsEqual(d, DIRECTION_TOLERANCE)) {
+        return;
+      }
+    }
+    directions.push_back(d);
+  };
+
+  // resting on a planar face means its outward normal points down
+  for (TopExp_Explorer exp(object.get_shape(), TopAbs_FACE); exp.More(); exp.Next()) {
+    const auto &face = TopoDS::Face(exp.Current());
+    auto surface = BRepAdaptor_Surface(face);
+    if (surface.GetType() != GeomAbs_Plane) {
+      continue;
+    }
+    auto normal = surface.Plane().Axis().Direction();
+    if (face.Orientation() == TopAbs_REVERSED) {
+      normal.Reverse();
+    }
+    add(normal);
+  }
+  // the object can also rest on a facet of its convex hull, e.g. a sphere on a
+  // cube, or a set of feet
+  for (const auto &normal : hull_normals(MAX_HULL_CANDIDATES)) {
+    add(normal);
+  }
+
+  auto result = std::vector<Candidate>();
+  for (const auto &d : directions) {
+    auto c = Candidate();
+    c.down = d;
+    result.push_back(c);
+  }
+  return result;
+}
+
+std::vector<Orienter::Candidate> Orienter::evaluate() const {
+  auto result = candidates();
+  spdlog::debug("Orienter: scoring {} candidate orientations", result.size());
+  OSD_Parallel::For(0, static_cast<int>(result.size()),
+                    [&](const int i) { score(result[i]); });
+  std::stable_sort(result.begin(), result.end(),
+                   [](const auto &lhs, const auto &rhs) { return lhs.cost < rhs.cost; });
+  return result;
+}
+
+Orienter::Candidate Orienter::orient() {
+  auto scored = evaluate();
+  if (scored.empty()) {
+    throw std::runtime_error("Orienter: no candidate orientations");
+  }
+  const auto &best = scored.front();
+  spdlog::info("Orienter: best orientation: down {:f},{:f},{:f}, {} layers, "
+               "{:.1f}mm² overhang, {:.1f}mm² contact",
+               best.down.X(), best.down.Y(), best.down.Z(), best.layers,
+               best.overhang_area, best.contact_area);
+
+  const auto t = rotation(best.down);
+  object.transform(t);
+  // rest the object on the build plate; the lowest mesh vertex is exact for
+  // planar contact faces
+  double zmin = RealLast();
+  for (const auto &tri : mesh) {
+    for (const auto &v : tri.vertices) {
+      zmin = std::min(zmin, gp_Pnt(v).Transformed(t).Z());
+    }
+  }
+  object.translate(0, 0, -zmin);
+  return best;
+}
+
+gp_Trsf Orienter::rotation(const gp_Dir &down) const {
+  const auto target = gp_Dir(0, 0, -1);
+  auto t = gp_Trsf();
+  if (down.IsEqual(target, Precision::Angular())) {
+    return t;
+  }
+  // pointing straight up, the axis of rotation is arbitrary
+  if (down.IsOpposite(target, Precision::Angular())) {
+    t.SetRotation(gp_Ax1(center, gp::DX()), M_PI);
+    return t;
+  }
+  // rotating about the cross product brings one vector onto the other
+  t.SetRotation(gp_Ax1(center, down.Crossed(target)), down.Angle(target));
+  return t;
+}
+
+void Orienter::score(Candidate &c) const {
+  const auto t = rotation(c.down);
+  // only the Z coordinates are needed: the third row of the rotation
+  const auto m = t.HVectorialPart();
+  const auto row = gp_XYZ(m(3, 1), m(3, 2), m(3, 3));
+  const double offset = t.TranslationPart().Z();
+  auto z = [&](const gp_XYZ &p) { return row.Dot(p) + offset; };
+
+  double zmin = RealLast(), zmax = RealFirst();
+  for (const auto &tri : mesh) {
+    for (const auto &v : tri.vertices) {
+      zmin = std::min(zmin, z(v));
+      zmax = std::max(zmax, z(v));
+    }
+  }
+
+  // faces within half a layer of the bottom rest on the build plate
+  const double bottom = zmin + layer_height / 2;
+  for (const auto &tri : mesh) {
+    const double nz = row.Dot(tri.normal);
+    // not facing down steeply enough to need support
+    if (nz > -overhang_limit) {
+      continue;
+    }
+    const bool on_plate = z(tri.vertices[0]) <= bottom &&
+                          z(tri.vertices[1]) <= bottom &&
+                          z(tri.vertices[2]) <= bottom;
+    if (on_plate) {
+      c.contact_area += tri.area;
+    } else {
+      c.overhang_area += tri.area;
+    }
+  }
+
+  c.height = zmax - zmin;
+  c.layers = static_cast<int>(std::ceil(c.height / layer_height - Precision::Confusion()));
+  // normalized criteria, so that neither the units nor the size of the object
+  // favor one of them
+  c.cost = weights.overhang * c.overhang_area / area +
+           weights.contact * c.contact_area / area + weights.height * c.height / diameter;
+}
+
+std::vector<gp_Dir> Orienter::hull_normals(std::size_t limit) const {
+  // unique mesh vertices
+  auto points = std::vector<gp_XYZ>();
+  for (const auto &tri : mesh) {
+    points.insert(points.end(), tri.vertices.begin(), tri.vertices.end());
+  }
+  std::sort(points.begin(), points.end(), [](const auto &lhs, const auto &rhs) {
+    return std::make_tuple(lhs.X(), lhs.Y(), lhs.Z()) <
+           std::make_tuple(rhs.X(), rhs.Y(), rhs.Z());
+  });
+  points.erase(std::unique(points.begin(), points.end(),
+                           [](const auto &lhs, const auto &rhs) {
+                             return lhs.IsEqual(rhs, Precision::Confusion());
+                           }),
+               points.end());
+  if (points.size() < 4) {
+    return {};
+  }
+
+  const double eps = Precision::Confusion();
+  // find an initial tetrahedron: two distant points, the point farthest from
+  // their line, then the point farthest from their plane
+  auto farthest = [&](auto distance) {
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < points.size(); ++i) {
+      if (distance(points[i]) > distance(points[best])) {
+        best = i;
+      }
+    }
+    return best;
+  };
+  const auto i0 = std::size_t{0};
+  const auto i1 = farthest([&](const gp_XYZ &p) { return (p - points[i0]).Modulus(); });
+  const auto line = points[i1] - points[i0];
+  const auto i2 = farthest([&](const gp_XYZ &p) { return ((p - points[i0]) ^ line).Modulus(); });
+  const auto plane = line ^ (points[i2] - points[i0]);
+  const auto i3 = farthest([&](const gp_XYZ &p) { return std::abs((p - points[i0]).Dot(plane)); });
+  // flat objects have no proper hull, their planar faces are enough
+  if (line.Modulus() < eps || plane.Modulus() < eps ||
+      std::abs((points[i3] - points[i0]).Dot(plane)) < eps * plane.Modulus()) {
+    return {};
+  }
+  const auto interior = (points[i0] + points[i1] + points[i2] + points[i3]) / 4;
+
+  struct Facet {
+    std::array<std::size_t, 3> v;
+    gp_XYZ normal;
+    double offset;
+    double area;
+  };
+  auto facets = std::vector<Facet>();
+  // directed edge -> facet
+  auto edges = std::map<std::pair<std::size_t, std::size_t>, std::size_t>();
+  auto alive = std::vector<std::size_t>();
+
+  auto add_facet = [&](std::size_t a, std::size_t b, std::size_t c) {
+    auto n = (points[b] - points[a]) ^ (points[c] - points[a]);
+    const double m = n.Modulus();
+    n = m > 0 ? n / m : n;
+    facets.push_back(Facet{{a, b, c}, n, n.Dot(points[a]), m / 2});
+    const auto id = facets.size() - 1;
+    edges[{a, b}] = id;
+    edges[{b, c}] = id;
+    edges[{c, a}] = id;
+    alive.push_back(id);
+  };
+  // initial facets, wound counterclockwise seen from outside
+  auto add_initial = [&](std::size_t a, std::size_t b, std::size_t c) {
+    const auto n = (points[b] - points[a]) ^ (points[c] - points[a]);
+    if (n.Dot(interior - points[a]) > 0) {
+      std::swap(b, c);
+    }
+    add_facet(a, b, c);
+  };
+  add_initial(i0, i1, i2);
+  add_initial(i0, i1, i3);
+  add_initial(i0, i2, i3);
+  add_initial(i1, i2, i3);
+
+  // add the remaining points one by one
+  auto visible = std::vector<char>();
+  for (std::size_t p = 0; p < points.size(); ++p) {
+    if (p == i0 || p == i1 || p == i2 || p == i3) {
+      continue;
+    }
+    visible.assign(facets.size(), 0);
+    bool any = false;
+    for (auto f : alive) {
+      if (facets[f].normal.Dot(points[p]) - facets[f].offset > eps) {
+        visible[f] = 1;
+        any = true;
+      }
+    }
+    // point is inside the hull
+    if (!any) {
+      continue;
+    }
+    // the horizon: edges between visible and hidden facets
+    auto horizon = std::vector<std::pair<std::size_t, std::size_t>>();
+    for (auto f : alive) {
+      if (!visible[f]) {
+        continue;
+      }
+      const auto &v = facets[f].v;
+      for (int k = 0; k < 3; ++k) {
+        const auto a = v[k], b = v[(k + 1) % 3];
+        auto twin = edges.find({b, a});
+        if (twin != edges.end() && !visible[twin->second]) {
+          horizon.emplace_back(a, b);
+        }
+      }
+    }
+    // remove the visible facets
+    for (auto f : alive) {
+      if (!visible[f]) {
+        continue;
+      }
+      const auto &v = facets[f].v;
+      for (int k = 0; k < 3; ++k) {
+        edges.erase({v[k], v[(k + 1) % 3]});
+      }
+    }
+    alive.erase(std::remove_if(alive.begin(), alive.end(),
+                               [&](auto f) { return visible[f] != 0; }),
+                alive.end());
+    // connect the horizon to the new point
+    for (const auto &[a, b] : horizon) {
+      add_facet(a, b, p);
+    }
+  }
+
+  // merge facets with the same normal, e.g. triangles of a flat side
+  auto normals = std::vector<std::pair<gp_Dir, double>>();
+  for (auto f : alive) {
+    if (facets[f].area < eps) {
+      continue;
+    }
+    const auto d = gp_Dir(facets[f].normal);
+    auto it = std::find_if(normals.begin(), normals.end(), [&](const auto &n) {
+      return n.first.IsEqual(d, DIRECTION_TOLERANCE);
+    });
+    if (it == normals.end()) {
+      normals.emplace_back(d, facets[f].area);
+    } else {
+      it->second += facets[f].area;
+    }
+  }
+  // biggest sides first
+  std::stable_sort(normals.begin(), normals.end(),
+                   [](const auto &lhs, const auto &rhs) { return lhs.second > rhs.second; });
+  if (normals.size() > limit) {
+    normals.resize(limit);
+  }
+
+  auto result = std::vector<gp_Dir>();
+  for (const auto &n : normals) {
+    result.push_back(n.first);
+  }
+  return result;
+}
+
+} // namespace sse
@@ -50,6 +50,8 @@ Packer::Packer(std::vector<std::shared_ptr<Object>> objects)
     if (o->get_bound_box().IsVoid()) {
       throw std::runtime_error("Binpack: object is empty");
     }
+    // packing needs tight bounds
+    o->get_bound_box(BoundsPrecision::Optimal);
   }
   // sort the objects, biggest to smallest, in terms of footprint
   // specifically, compare the largest dimension (X or Y) of each object
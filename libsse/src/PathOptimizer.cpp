@@ -0,0 +1,301 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file PathOptimizer.cpp
+ * @brief Orders the paths of a layer to minimize travel
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/PathOptimizer.hpp>
+
+namespace sse {
+
+// maximum number of 2-opt passes over the tour
+constexpr int MAX_PASSES = 10;
+
+namespace {
+
+/**
+ * @brief Uniform grid of the entry points of the contours, for nearest
+ * neighbour lookups
+ */
+class Grid {
+public:
+  //! candidate entry point: contour, vertex (or end of an open path)
+  struct Entry {
+    gp_XY point;
+    std::size_t contour;
+    std::size_t vertex;
+  };
+
+  explicit Grid(const std::vector<Entry> &entries) {
+    if (entries.empty()) {
+      return;
+    }
+    double xmin = std::numeric_limits<double>::max(), ymin = xmin;
+    double xmax = std::numeric_limits<double>::lowest(), ymax = xmax;
+    for (const auto &e : entries) {
+      xmin = std::min(xmin, e.point.X()), ymin = std::min(ymin, e.point.Y());
+      xmax = std::max(xmax, e.point.X()), ymax = std::max(ymax, e.point.Y());
+    }
+    // about one entry per cell, also when the entries are (nearly) collinear
+    const double n = static_cast<double>(entries.size());
+    cell = std::max({std::sqrt((xmax - xmin) * (ymax - ymin) / n),
+                     std::max(xmax - xmin, ymax - ymin) / n, Precision::Confusion()});
+    for (const auto &e : entries) {
+      cells[key(index(e.point.X()), index(e.point.Y()))].push_back(e);
+    }
+    imin = index(xmin), jmin = index(ymin), imax = index(xmax), jmax = index(ymax);
+  }
+
+  /**
+   * @brief Find the entry closest to a point, among unvisited contours
+   * @return false if every contour is visited
+   */
+  bool nearest(const gp_XY &p, const std::vector<bool> &visited, Entry &result) const {
+    if (cells.empty()) {
+      return false;
+    }
+    const auto pi = index(p.X()), pj = index(p.Y());
+    // rings of cells around the point, until no closer entry can be found
+    const auto rings = std::max({std::abs(pi - imin), std::abs(pi - imax),
+                                 std::abs(pj - jmin), std::abs(pj - jmax)});
+    double best = std::numeric_limits<double>::max();
+    bool found = false;
+    const auto visit = [&](std::int64_t i, std::int64_t j) {
+      const auto it = cells.find(key(i, j));
+      if (it == cells.end()) {
+        return;
+      }
+      for (const auto &e : it->second) {
+        const double d = (e.point - p).SquareModulus();
+        if (!visited[e.contour] && (!found || d < best * best)) {
+          best = std::sqrt(d);
+          result = e;
+          found = true;
+        }
+      }
+    };
+    for (std::int64_t r = 0; r <= rings; ++r) {
+      // entries in further rings are at least this far
+      if (found && best <= (r - 1) * cell) {
+        break;
+      }
+      if (r == 0) {
+        visit(pi, pj);
+        continue;
+      }
+      // only the boundary of the ring
+      for (auto i = pi - r; i <= pi + r; ++i) {
+        visit(i, pj - r);
+        visit(i, pj + r);
+      }
+      for (auto j = pj - r + 1; j < pj + r; ++j) {
+        visit(pi - r, j);
+        visit(pi + r, j);
+      }
+    }
+    return found;
+  }
+
+private:
+  std::int64_t index(double x) const { return static_cast<std::int64_t>(std::floor(x / cell)); }
+
+  static std::int64_t key(std::int64_t i, std::int64_t j) { return (i << 32) ^ (j & 0xffffffff); }
+
+  //! size of a cell
+  double cell{1};
+  //! range of the occupied cells
+  std::int64_t imin{0}, jmin{0}, imax{0}, jmax{0};
+  //! entries of each cell
+  std::unordered_map<std::int64_t, std::vector<Entry>> cells;
+};
+
+} // namespace
+
+PathOptimizer::PathOptimizer(const gp_XY &start, std::size_t max_two_opt)
+    : start(start), max_two_opt(max_two_opt) {}
+
+std::vector<PathOptimizer::Stop>
+PathOptimizer::nearest_neighbour(const std::vector<Contour> &contours) const {
+  auto entries = std::vector<Grid::Entry>();
+  for (std::size_t c = 0; c < contours.size(); ++c) {
+    const auto &contour = contours[c];
+    if (contour.closed()) {
+      for (std::size_t v = 0; v < contour.size(); ++v) {
+        entries.push_back({contour.points[v], c, v});
+      }
+    } else if (!contour.points.empty()) {
+      entries.push_back({contour.points.front(), c, 0});
+      entries.push_back({contour.points.back(), c, contour.points.size() - 1});
+    }
+  }
+  const auto grid = Grid(entries);
+
+  auto tour = std::vector<Stop>();
+  auto visited = std::vector<bool>(contours.size(), false);
+  auto position = start;
+  auto e = Grid::Entry();
+  while (grid.nearest(position, visited, e)) {
+    visited[e.contour] = true;
+    const auto &contour = contours[e.contour];
+    auto stop = Stop();
+    stop.contour = e.contour;
+    stop.closed = contour.closed();
+    stop.entry = e.point;
+    if (stop.closed) {
+      stop.vertex = e.vertex;
+      stop.exit = e.point;
+    } else {
+      stop.reversed = e.vertex != 0;
+      stop.exit = stop.reversed ? contour.points.front() : contour.points.back();
+    }
+    position = stop.exit;
+    tour.push_back(stop);
+  }
+  return tour;
+}
+
+void PathOptimizer::two_opt(std::vector<Stop> &tour) const {
+  const auto n = tour.size();
+  if (n < 3 || n > max_two_opt) {
+    return;
+  }
+  bool improved = true;
+  for (int pass = 0; improved && pass < MAX_PASSES; ++pass) {
+    improved = false;
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+      for (std::size_t j = i + 1; j < n; ++j) {
+        // reversing tour[i..j]: the tool goes from prev to the exit of j, which
+        // becomes an entry, and from the entry of i, which becomes an exit, to
+        // next; the tour is open, so the last stop has no next
+        const auto &prev = i == 0 ? start : tour[i - 1].exit;
+        const auto &a = tour[i].entry, &b = tour[j].exit;
+        double delta = (b - prev).Modulus() - (a - prev).Modulus();
+        if (j + 1 < n) {
+          const auto &next = tour[j + 1].entry;
+          delta += (next - a).Modulus() - (next - b).Modulus();
+        }
+        if (delta < -Precision::Confusion()) {
+          std::reverse(tour.begin() + i, tour.begin() + j + 1);
+          for (auto k = i; k <= j; ++k) {
+            std::swap(tour[k].entry, tour[k].exit);
+            tour[k].reversed = !tour[k].reversed;
+          }
+          improved = true;
+        }
+      }
+    }
+  }
+}
+
+gp_XY PathOptimizer::optimize(std::vector<Contour> &contours,
+                              std::vector<std::size_t> *order) const {
+  sequence(contours, order);
+  return connect(contours, start, order);
+}
+
+void PathOptimizer::sequence(std::vector<Contour> &contours,
+                             std::vector<std::size_t> *order) const {
+  auto tour = nearest_neighbour(contours);
+  two_opt(tour);
+  if (order != nullptr) {
+    order->clear();
+    for (const auto &stop : tour) {
+      order->push_back(stop.contour);
+    }
+  }
+
+  auto result = std::vector<Contour>();
+  result.reserve(contours.size());
+  for (auto &stop : tour) {
+    auto &contour = contours[stop.contour];
+    if (!stop.closed && stop.reversed) {
+      contour.reverse();
+    }
+    result.push_back(std::move(contour));
+  }
+  contours = std::move(result);
+}
+
+gp_XY PathOptimizer::connect(std::vector<Contour> &contours, const gp_XY &from,
+                             std::vector<std::size_t> *order) {
+  // closest vertex of a loop, or the end of an open path the tool enters by
+  const auto closest = [&](const Contour &contour, bool first) {
+    if (!contour.closed()) {
+      return (first ? contour.points.front() : contour.points.back()) - from;
+    }
+    auto best = contour.points.front() - from;
+    for (const auto &p : contour.points) {
+      if ((p - from).SquareModulus() < best.SquareModulus()) {
+        best = p - from;
+      }
+    }
+    return best;
+  };
+  if (contours.size() > 1 && !contours.back().points.empty() &&
+      !contours.front().points.empty() &&
+      closest(contours.back(), false).SquareModulus() <
+          closest(contours.front(), true).SquareModulus()) {
+    std::reverse(contours.begin(), contours.end());
+    for (auto &c : contours) {
+      if (!c.closed()) {
+        c.reverse();
+      }
+    }
+    if (order != nullptr) {
+      std::reverse(order->begin(), order->end());
+    }
+  }
+
+  auto position = from;
+  for (auto &contour : contours) {
+    if (contour.closed()) {
+      // loops are never reversed, to keep their direction
+      std::size_t best = 0;
+      for (std::size_t v = 1; v < contour.size(); ++v) {
+        if ((contour.points[v] - position).SquareModulus() <
+            (contour.points[best] - position).SquareModulus()) {
+          best = v;
+        }
+      }
+      contour.rotate(best);
+    }
+    if (!contour.points.empty()) {
+      position = contour.points.back();
+    }
+  }
+  return position;
+}
+
+double PathOptimizer::travel(const std::vector<Contour> &contours, const gp_XY &start) {
+  double result = 0;
+  auto position = start;
+  for (const auto &c : contours) {
+    if (c.points.empty()) {
+      continue;
+    }
+    result += (c.points.front() - position).Modulus();
+    position = c.points.back();
+  }
+  return result;
+}
+
+} // namespace sse
@@ -47,6 +47,59 @@ void Settings::parse(fs::path _file) {
   }
 }
 
+namespace {
+
+/**
+ * @brief Merge a value into another, recursively for tables
+ */
+void merge_into(toml::value &target, const toml::value &source) {
+  if (!target.is_table() || !source.is_table()) {
+    target = source;
+    return;
+  }
+  auto &table = target.as_table();
+  for (const auto &[key, value] : source.as_table()) {
+    const auto it = table.find(key);
+    if (it == table.end()) {
+      table.emplace(key, value);
+    } else {
+      merge_into(it->second, value);
+    }
+  }
+}
+
+} // namespace
+
+void Settings::merge(const toml::value &overrides) {
+  if (!overrides.is_table()) {
+    throw std::runtime_error("Settings: overrides must be a table");
+  }
+  merge_into(config, overrides);
+}
+
+const toml::value *Settings::find_value(const toml::value &table, const std::string &setting) {
+  const toml::value *value = &table;
+  std::string::size_type begin = 0;
+  // walk the nested tables, one key at a time
+  while (true) {
+    if (!value->is_table()) {
+      return nullptr;
+    }
+    const auto end = setting.find('.', begin);
+    const auto key = setting.substr(begin, end == std::string::npos ? end : end - begin);
+    const auto &table = value->as_table();
+    const auto it = table.find(key);
+    if (it == table.end()) {
+      return nullptr;
+    }
+    value = &it->second;
+    if (end == std::string::npos) {
+      return value;
+    }
+    begin = end + 1;
+  }
+}
+
 std::string Settings::dump() {
   return "";
 }
@@ -0,0 +1,168 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file SkinDetector.cpp
+ * @brief Finds the regions of each layer that need solid infill
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/SkinDetector.hpp>
+
+#include <clipper.hpp>
+
+namespace sse {
+
+// integer units per mm, for clipper
+constexpr double SCALE = 1e6;
+
+namespace {
+
+/**
+ * @brief Convert outlines to clipper polygons
+ */
+ClipperLib::Paths to_paths(const std::vector<Contour> &contours, double tolerance) {
+  auto result = ClipperLib::Paths();
+  for (const auto &c : contours) {
+    if (!c.closed()) {
+      continue;
+    }
+    auto points = c.flatten(tolerance);
+    // the last point duplicates the first one
+    points.pop_back();
+    auto path = ClipperLib::Path();
+    path.reserve(points.size());
+    for (const auto &p : points) {
+      path.emplace_back(static_cast<ClipperLib::cInt>(std::llround(p.X() * SCALE)),
+                        static_cast<ClipperLib::cInt>(std::llround(p.Y() * SCALE)));
+    }
+    result.push_back(std::move(path));
+  }
+  return result;
+}
+
+/**
+ * @brief Convert clipper polygons to closed outlines
+ */
+std::vector<Contour> to_contours(const ClipperLib::Paths &paths, double z) {
+  auto result = std::vector<Contour>();
+  for (const auto &path : paths) {
+    if (path.size() < 3) {
+      continue;
+    }
+    auto c = Contour();
+    c.z = z;
+    c.move_to(gp_XY(path.front().X / SCALE, path.front().Y / SCALE));
+    for (std::size_t i = 1; i < path.size(); ++i) {
+      c.line_to(gp_XY(path[i].X / SCALE, path[i].Y / SCALE));
+    }
+    c.line_to(c.points.front());
+    result.push_back(std::move(c));
+  }
+  return result;
+}
+
+/**
+ * @brief Boolean operation between two regions
+ */
+ClipperLib::Paths execute(ClipperLib::ClipType type, const ClipperLib::Paths &a,
+                          const ClipperLib::Paths &b) {
+  auto clipper = ClipperLib::Clipper();
+  clipper.AddPaths(a, ClipperLib::ptSubject, true);
+  clipper.AddPaths(b, ClipperLib::ptClip, true);
+  auto result = ClipperLib::Paths();
+  clipper.Execute(type, result, ClipperLib::pftEvenOdd, ClipperLib::pftEvenOdd);
+  return result;
+}
+
+/**
+ * @brief Part of a region not covered by all the layers of a window
+ * @param region Region of the layer
+ * @param window Regions of the neighbouring layers, nullptr past the first
+ * or last layer
+ */
+ClipperLib::Paths uncovered(const ClipperLib::Paths &region,
+                            const std::vector<const ClipperLib::Paths *> &window) {
+  if (window.empty()) {
+    return {};
+  }
+  if (std::any_of(window.begin(), window.end(), [](const auto *w) { return w == nullptr; })) {
+    // nothing covers the layer past the first or last layer
+    return region;
+  }
+  auto covered = *window.front();
+  for (std::size_t k = 1; k < window.size() && !covered.empty(); ++k) {
+    covered = execute(ClipperLib::ctIntersection, covered, *window[k]);
+  }
+  return execute(ClipperLib::ctDifference, region, covered);
+}
+
+} // namespace
+
+SkinDetector::SkinDetector(int top_layers, int bottom_layers, double tolerance,
+                           double min_width)
+    : top_layers(std::max(top_layers, 0)), bottom_layers(std::max(bottom_layers, 0)),
+      tolerance(tolerance), min_width(min_width) {}
+
+std::vector<std::vector<Contour>>
+SkinDetector::detect(const std::vector<std::vector<Contour>> &layers) const {
+  const int n = static_cast<int>(layers.size());
+  // convert every layer once, the windows share them
+  auto regions = std::vector<ClipperLib::Paths>(layers.size());
+  OSD_Parallel::For(0, n, [&](const int i) { regions[i] = to_paths(layers[i], tolerance); });
+
+  auto result = std::vector<std::vector<Contour>>(layers.size());
+  OSD_Parallel::For(0, n, [&](const int i) {
+    const auto neighbours = [&](int first, int count, int step) {
+      auto window = std::vector<const ClipperLib::Paths *>();
+      for (int k = 0; k < count; ++k) {
+        const int j = first + k * step;
+        window.push_back(j >= 0 && j < n ? &regions[j] : nullptr);
+      }
+      return window;
+    };
+    const auto top = uncovered(regions[i], neighbours(i + 1, top_layers, 1));
+    const auto bottom = uncovered(regions[i], neighbours(i - 1, bottom_layers, -1));
+    auto solid = execute(ClipperLib::ctUnion, top, bottom);
+    if (min_width > 0 && !solid.empty()) {
+      // opening: shrink then grow back, which drops the narrow parts
+      auto offset = ClipperLib::ClipperOffset();
+      offset.AddPaths(solid, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
+      offset.Execute(solid, -min_width / 2 * SCALE);
+      offset.Clear();
+      offset.AddPaths(solid, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
+      offset.Execute(solid, min_width / 2 * SCALE);
+      // growing back may overshoot the region at sharp corners
+      solid = execute(ClipperLib::ctIntersection, solid, regions[i]);
+    }
+    const double z = layers[i].empty() ? 0.0 : layers[i].front().z;
+    result[i] = to_contours(solid, z);
+  });
+  return result;
+}
+
+std::vector<Contour> SkinDetector::intersection(const std::vector<Contour> &a,
+                                                const std::vector<Contour> &b,
+                                                double tolerance) {
+  const double z = a.empty() ? 0.0 : a.front().z;
+  return to_contours(
+      execute(ClipperLib::ctIntersection, to_paths(a, tolerance), to_paths(b, tolerance)), z);
+}
+
+} // namespace sse
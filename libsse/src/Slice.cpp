@@ -26,10 +26,28 @@
 
 namespace sse {
 
+namespace {
+
+/**
+ * @brief Group a list of shapes into a compound
+ */
+TopoDS_Compound make_compound(const TopTools_ListOfShape &shapes) {
+  auto builder = BRep_Builder();
+  TopoDS_Compound result;
+  builder.MakeCompound(result);
+  for (const auto &s : shapes) {
+    builder.Add(result, s);
+  }
+  return result;
+}
+
+} // namespace
+
 // FIXME: figure out what to do with filename field of Object
 Slice::Slice(TopoDS_Shape &s) : Object(s) {
-  // regenerate bounding box, optimized with no gap
-  generate_bounds(true, 0.0);
+  // regenerate bounding box with no gap; the fast bounds computed by Object
+  // are reused, slices don't need tight bounds
+  generate_bounds(false, 0.0);
 
   faces = TopTools_HSequenceOfShape();
   wires = TopTools_ListOfShape();
@@ -76,38 +94,114 @@ Slice::Slice(TopoDS_Shape &s) : Object(s) {
   }
 }
 
-// TODO: better API, i.e. list of offset dimensions
+Slice::Slice(const TopTools_ListOfShape &layer_faces)
+    : Object(make_compound(layer_faces)) {
+  // slices don't need tight bounds, nor a gap
+  generate_bounds(false, 0.0);
+
+  faces = TopTools_HSequenceOfShape();
+  wires = TopTools_ListOfShape();
+  // the faces are already the bottom of the slice
+  for (const auto &f : layer_faces) {
+    faces.Append(f);
+  }
+}
+
+void Slice::set_face_settings(int i, const CompiledSettings &s) {
+  face_settings[i] = s;
+}
+
+const CompiledSettings &Slice::get_face_settings(int i) const {
+  const auto it = face_settings.find(i);
+  return it == face_settings.end() ? settings : it->second;
+}
+
 void Slice::generate_shells(int num, double width) {
+  offset_faces(std::vector<int>(faces.Length(), num),
+               std::vector<double>(faces.Length(), width));
+}
 
-  // loop over all faces
-  for (const auto &f : faces) {
-    // cast from TopoDS_Shape to TopoDS_Face
-    const TopoDS_Face &face = TopoDS::Face(f);
-    // adding face automatically adds all wires
-    auto b = BRepOffsetAPI_MakeOffset(face, GeomAbs_Arc);
+void Slice::generate_shells() {
+  auto shells = std::vector<int>();
+  auto widths = std::vector<double>();
+  for (int f = 1; f <= faces.Length(); ++f) {
+    const auto &s = get_face_settings(f);
+    shells.push_back(s.shells);
+    widths.push_back(s.extrusion_width);
+  }
+  offset_faces(shells, widths);
+}
 
+void Slice::offset_faces(const std::vector<int> &shells, const std::vector<double> &widths) {
+  wires.Clear();
+  // one task per face and per shell: a builder computes a single offset, each
+  // Perform() replacing the previous result
+  auto tasks = std::vector<std::pair<int, int>>();
+  for (int f = 0; f < faces.Length(); ++f) {
+    for (int i = 1; i <= shells[f]; ++i) {
+      tasks.emplace_back(f, i);
+    }
+  }
+  auto results = std::vector<TopoDS_Shape>(tasks.size());
+  OSD_Parallel::For(0, static_cast<int>(tasks.size()), [&](const int k) {
+    const auto [f, i] = tasks[k];
+    const double width = widths[f];
+    // the sequence is 1-based
+    const auto &face = TopoDS::Face(faces.Value(f + 1));
     try {
-      // for each offset
-      for (int i = 1; i <= num; ++i) {
-        // make the offset
-        // TODO: allow for both outward and inward offsets
-        b.Perform(-1 * i * width);
+      // work on a copy, the faces are shared between the tasks
+      auto b = BRepOffsetAPI_MakeOffset(TopoDS::Face(BRepBuilderAPI_Copy(face).Shape()),
+                                        GeomAbs_Arc);
+      // TODO: allow for both outward and inward offsets
+      // the extrusion is centered on the path: the outer edge of the first
+      // shell lies on the outline
+      b.Perform(-(i - 0.5) * width);
+      if (b.IsDone()) {
+        results[k] = b.Shape();
       }
+    } catch (const Standard_Failure &e) {
+      // e.g. the face is too thin for this shell
+      spdlog::debug("offset failure: shell {}: {}", i, e.GetMessageString());
+    }
+  });
 
-    } catch (StdFail_NotDone &e) {
-      spdlog::error("offset failure");
-      // catch build error
-      e.Print(std::cerr);
+  // wires of each face, from the outside in
+  for (const auto &r : results) {
+    if (r.IsNull()) {
+      continue;
+    }
+    for (auto exp = TopExp_Explorer(r, TopAbs_WIRE); exp.More(); exp.Next()) {
+      wires.Append(exp.Current());
     }
+  }
+}
 
-    // get all the generated offsets
-    // FIXME: currently returns empty list
-    auto tmp = b.Generated(f);
-    for (const auto &s : tmp) {
-      spdlog::debug(TopAbs::ShapeTypeToString(s.ShapeType()));
+void Slice::generate_contours(double tolerance) {
+  contours.clear();
+  outlines.clear();
+  // the faces are the bottom of the slab, the nozzle prints its top
+  const double z = print_height();
+  // outlines of the layer, i.e. the outer and hole boundaries of each face;
+  // not printed, the shells are inside them
+  for (const auto &f : faces) {
+    for (auto exp = TopExp_Explorer(f, TopAbs_WIRE); exp.More(); exp.Next()) {
+      auto c = Contour::from_wire(TopoDS::Wire(exp.Current()), tolerance);
+      if (!c.empty()) {
+        c.z = z;
+        outlines.push_back(std::move(c));
+      }
     }
-    wires.Append(tmp);
   }
+  // shells
+  for (const auto &s : wires) {
+    for (auto exp = TopExp_Explorer(s, TopAbs_WIRE); exp.More(); exp.Next()) {
+      contours.push_back(Contour::from_wire(TopoDS::Wire(exp.Current()), tolerance));
+      contours.back().z = z;
+    }
+  }
+  contours.erase(std::remove_if(contours.begin(), contours.end(),
+                                [](const auto &c) { return c.empty(); }),
+                 contours.end());
 }
 
 void Slice::generate_infill(double percent, double angle, double line_width) {
@@ -126,9 +220,13 @@ void Slice::generate_infill(double percent, double angle, double line_width) {
   }
 }
 
+double Slice::print_height() const {
+  // the faces are the bottom of the slab
+  return get_bound_box().CornerMin().Z() + settings.layer_height;
+}
+
 bool Slice::operator<(const Slice &rhs) const {
-  // compare lowest Z coordinate of both bounding boxes
-  return get_bound_box().CornerMin().Z() < rhs.get_bound_box().CornerMin().Z();
+  return print_height() < rhs.print_height();
 }
 
 } // namespace sse
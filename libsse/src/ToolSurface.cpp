@@ -0,0 +1,123 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ToolSurface.cpp
+ * @brief Families of (non-planar) slicing surfaces
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/ToolSurface.hpp>
+
+namespace sse {
+
+// tool faces extend this far beyond the region, so they cut cleanly through it
+constexpr double MARGIN = 1.0;
+
+ToolSurface::ToolSurface(const Bnd_Box &bounds, double layer_height)
+    : layer_height(layer_height) {
+  if (bounds.IsVoid() || bounds.IsOpen()) {
+    throw std::runtime_error("ToolSurface: invalid region");
+  }
+  if (layer_height <= 0) {
+    throw std::runtime_error("ToolSurface: invalid layer height");
+  }
+  bounds.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+  const double gap = bounds.GetGap();
+  xmin += gap, ymin += gap, zmin += gap;
+  xmax -= gap, ymax -= gap, zmax -= gap;
+  center = gp_Pnt((xmin + xmax) / 2, (ymin + ymax) / 2, zmin);
+  radius = std::hypot(xmax - xmin, ymax - ymin) / 2 + MARGIN;
+}
+
+PlanarToolSurface::PlanarToolSurface(const Bnd_Box &bounds, double layer_height)
+    : ToolSurface(bounds, layer_height) {
+  // the first layer is one layer above the bottom, the last at the top
+  start = zmin + layer_height;
+  layers = static_cast<std::size_t>(
+      std::floor((zmax - zmin) / layer_height + Precision::Confusion()));
+}
+
+TopoDS_Face PlanarToolSurface::face(std::size_t i) const {
+  // the parameters of a plane on the XY axes are its X,Y coordinates
+  auto plane = gp_Pln(gp_Ax3(gp_Pnt(0, 0, height(i)), gp::DZ(), gp::DX()));
+  return BRepBuilderAPI_MakeFace(plane, xmin - MARGIN, xmax + MARGIN,
+                                 ymin - MARGIN, ymax + MARGIN)
+      .Face();
+}
+
+ConicalToolSurface::ConicalToolSurface(const Bnd_Box &bounds, double layer_height,
+                                       double angle)
+    : ToolSurface(bounds, layer_height) {
+  if (std::abs(angle) < Precision::Angular() * 180 / M_PI || std::abs(angle) >= 90) {
+    throw std::runtime_error("ConicalToolSurface: invalid angle");
+  }
+  slope = std::tan(angle * M_PI / 180);
+  // the apex of the cone is at height(i); the cones must cover every point of
+  // the region, from its bottom edge to its top edge
+  start = zmin + layer_height - std::max(slope, 0.0) * radius;
+  const double end = zmax + std::max(-slope, 0.0) * radius;
+  layers = static_cast<std::size_t>(
+      std::floor((end - start) / layer_height + Precision::Confusion())) + 1;
+}
+
+TopoDS_Face ConicalToolSurface::face(std::size_t i) const {
+  // OCCT cones are defined by the angle between the generatrix and the axis,
+  // so an inverted cone points its axis down
+  const auto axis = slope > 0 ? gp::DZ() : -gp::DZ();
+  const double semi_angle = std::atan(1 / std::abs(slope));
+  auto apex = gp_Pnt(center.X(), center.Y(), height(i));
+  Handle(Geom_ConicalSurface) cone =
+      new Geom_ConicalSurface(gp_Ax3(apex, axis, gp::DX()), semi_angle, 0.0);
+  // along the generatrix, the radius grows by sin(semi_angle) per unit
+  return BRepBuilderAPI_MakeFace(cone, 0, 2 * M_PI, 0,
+                                 radius / std::sin(semi_angle),
+                                 Precision::Confusion())
+      .Face();
+}
+
+SphericalToolSurface::SphericalToolSurface(const Bnd_Box &bounds,
+                                           double layer_height,
+                                           double sphere_radius)
+    : ToolSurface(bounds, layer_height), sphere_radius(sphere_radius) {
+  if (sphere_radius <= 0) {
+    throw std::runtime_error("SphericalToolSurface: invalid radius");
+  }
+  start = zmin + layer_height;
+  // the last sphere must reach the top corners of the region
+  const double end = std::hypot(radius, zmax - zmin + sphere_radius);
+  layers = static_cast<std::size_t>(std::floor(
+      (end - sphere_radius - layer_height) / layer_height + Precision::Confusion())) + 1;
+}
+
+TopoDS_Face SphericalToolSurface::face(std::size_t i) const {
+  const double r = sphere_radius + (i + 1) * layer_height;
+  // all the spheres share the same center, below the region
+  auto origin = gp_Pnt(center.X(), center.Y(), zmin - sphere_radius);
+  Handle(Geom_SphericalSurface) sphere =
+      new Geom_SphericalSurface(gp_Ax3(origin, gp::DZ(), gp::DX()), r);
+  // cap above the latitude where the sphere leaves the region, or the upper
+  // hemisphere if it's smaller than the region
+  const double latitude = r > radius ? std::acos(radius / r) : 0.0;
+  return BRepBuilderAPI_MakeFace(sphere, 0, 2 * M_PI, latitude, M_PI / 2,
+                                 Precision::Confusion())
+      .Face();
+}
+
+} // namespace sse
@@ -0,0 +1,292 @@
+/**
+ * StepSlicerEngine
+ * Copyright (C) 2020 Karl Nilsson
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file TravelPlanner.cpp
+ * @brief Routes travel moves inside a layer, to avoid retractions
+ *
+ * @author Karl Nilsson
+ */
+
+#include <sse/TravelPlanner.hpp>
+
+namespace sse {
+
+namespace {
+
+/**
+ * @brief Orientation of c relative to the line ab: positive if on its left
+ */
+double orientation(const gp_XY &a, const gp_XY &b, const gp_XY &c) {
+  return (b - a).Crossed(c - a);
+}
+
+} // namespace
+
+TravelPlanner::TravelPlanner(const std::vector<Contour> &outlines, double tolerance,
+                             double clearance, std::size_t max_vertices) {
+  auto polygons = std::vector<std::vector<gp_XY>>();
+  for (const auto &c : outlines) {
+    if (!c.closed()) {
+      continue;
+    }
+    polygons.push_back(c.flatten(tolerance));
+    const auto &polygon = polygons.back();
+    for (std::size_t i = 0; i + 1 < polygon.size(); ++i) {
+      edges.emplace_back(polygon[i], polygon[i + 1]);
+    }
+  }
+
+  // about one edge per cell, over the bounds of the edges, slightly enlarged
+  // so that no edge lies on the border of the grid
+  if (!edges.empty()) {
+    auto low = edges.front().first, high = low;
+    for (const auto &e : edges) {
+      for (const auto &p : {e.first, e.second}) {
+        low.SetCoord(std::min(low.X(), p.X()), std::min(low.Y(), p.Y()));
+        high.SetCoord(std::max(high.X(), p.X()), std::max(high.Y(), p.Y()));
+      }
+    }
+    const double margin = Precision::Confusion();
+    origin = low - gp_XY(margin, margin);
+    const auto extent = high - low + gp_XY(2 * margin, 2 * margin);
+    const auto side = std::ceil(std::sqrt(static_cast<double>(edges.size())));
+    size = std::max(extent.X(), extent.Y()) / side;
+    columns = std::max(1, static_cast<int>(std::ceil(extent.X() / size)));
+    rows = std::max(1, static_cast<int>(std::ceil(extent.Y() / size)));
+    cells.resize(static_cast<std::size_t>(columns) * rows);
+    bands.resize(rows);
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+      const auto &a = edges[i].first, &b = edges[i].second;
+      // every cell the bounds of the edge overlap, a superset of those it
+      // passes through, so that a crossing is in a cell of both segments
+      const int x0 = cell(std::min(a.X(), b.X()) - margin, origin.X(), columns);
+      const int x1 = cell(std::max(a.X(), b.X()) + margin, origin.X(), columns);
+      const int y0 = cell(std::min(a.Y(), b.Y()) - margin, origin.Y(), rows);
+      const int y1 = cell(std::max(a.Y(), b.Y()) + margin, origin.Y(), rows);
+      for (int y = y0; y <= y1; ++y) {
+        bands[y].push_back(i);
+        for (int x = x0; x <= x1; ++x) {
+          cells[static_cast<std::size_t>(y) * columns + x].push_back(i);
+        }
+      }
+    }
+  }
+
+  too_complex = edges.size() > max_vertices;
+  if (too_complex) {
+    return;
+  }
+  for (const auto &polygon : polygons) {
+    // the last point duplicates the first one
+    const auto n = polygon.size() - 1;
+    // move each vertex inwards along the bisector of its edges, so routes
+    // don't follow the perimeters themselves
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto &p = polygon[i];
+      auto before = p - polygon[(i + n - 1) % n];
+      auto after = polygon[i + 1] - p;
+      if (before.Modulus() < Precision::Confusion() ||
+          after.Modulus() < Precision::Confusion()) {
+        continue;
+      }
+      before.Normalize();
+      after.Normalize();
+      auto bisector = gp_XY(-(before + after).Y(), (before + after).X());
+      if (bisector.Modulus() < Precision::Confusion()) {
+        // the outline turns back on itself
+        bisector = gp_XY(-before.Y(), before.X());
+      }
+      bisector.Normalize();
+      // the region may be on either side, depending on the orientation
+      for (const auto &candidate : {p + bisector * clearance, p - bisector * clearance}) {
+        if (inside(candidate)) {
+          nodes.push_back(candidate);
+          break;
+        }
+      }
+    }
+  }
+  visibility.assign(nodes.size() * nodes.size(), 0);
+}
+
+int TravelPlanner::cell(double coordinate, double low, int count) const {
+  const double i = std::floor((coordinate - low) / size);
+  return static_cast<int>(std::clamp(i, 0.0, count - 1.0));
+}
+
+bool TravelPlanner::inside(const gp_XY &p) const {
+  if (bands.empty() || p.Y() < origin.Y() || p.Y() > origin.Y() + rows * size) {
+    return false;
+  }
+  // even-odd rule, casting a ray towards +X, over the edges of the row of p
+  bool result = false;
+  for (const auto i : bands[cell(p.Y(), origin.Y(), rows)]) {
+    const auto &a = edges[i].first, &b = edges[i].second;
+    if ((a.Y() > p.Y()) != (b.Y() > p.Y())) {
+      const double x = a.X() + (p.Y() - a.Y()) * (b.X() - a.X()) / (b.Y() - a.Y());
+      if (p.X() < x) {
+        result = !result;
+      }
+    }
+  }
+  return result;
+}
+
+bool TravelPlanner::crosses(const gp_XY &a, const gp_XY &b) const {
+  if (cells.empty()) {
+    return false;
+  }
+  // clip the segment to the grid (Liang-Barsky), no edge lies outside
+  const auto d = b - a;
+  double t0 = 0, t1 = 1;
+  const auto clip = [&](double p, double q) {
+    if (std::abs(p) < std::numeric_limits<double>::min()) {
+      return q >= 0;
+    }
+    const double t = q / p;
+    if (p < 0) {
+      t0 = std::max(t0, t);
+    } else {
+      t1 = std::min(t1, t);
+    }
+    return t0 <= t1;
+  };
+  const auto high = origin + gp_XY(columns * size, rows * size);
+  if (!clip(-d.X(), a.X() - origin.X()) || !clip(d.X(), high.X() - a.X()) ||
+      !clip(-d.Y(), a.Y() - origin.Y()) || !clip(d.Y(), high.Y() - a.Y())) {
+    return false;
+  }
+  const auto start = a + d * t0;
+
+  // walk the cells along the segment, testing the edges in each
+  int x = cell(start.X(), origin.X(), columns), y = cell(start.Y(), origin.Y(), rows);
+  const auto end = a + d * t1;
+  const int x1 = cell(end.X(), origin.X(), columns), y1 = cell(end.Y(), origin.Y(), rows);
+  const int step_x = d.X() > 0 ? 1 : -1, step_y = d.Y() > 0 ? 1 : -1;
+  const double infinity = std::numeric_limits<double>::infinity();
+  // parameters, along d, of the next column and row borders
+  double next_x = std::abs(d.X()) > 0
+                      ? (origin.X() + (x + (step_x > 0)) * size - a.X()) / d.X()
+                      : infinity;
+  double next_y = std::abs(d.Y()) > 0
+                      ? (origin.Y() + (y + (step_y > 0)) * size - a.Y()) / d.Y()
+                      : infinity;
+  const double delta_x = std::abs(d.X()) > 0 ? size / std::abs(d.X()) : infinity;
+  const double delta_y = std::abs(d.Y()) > 0 ? size / std::abs(d.Y()) : infinity;
+  const auto crossed = [&](int column, int row) {
+    for (const auto i : cells[static_cast<std::size_t>(row) * columns + column]) {
+      const auto &c = edges[i].first, &e = edges[i].second;
+      // proper intersection only: moves start and end on the perimeters
+      if (orientation(a, b, c) * orientation(a, b, e) < 0 &&
+          orientation(c, e, a) * orientation(c, e, b) < 0) {
+        return true;
+      }
+    }
+    return false;
+  };
+  while (!(x == x1 && y == y1)) {
+    if (crossed(x, y)) {
+      return true;
+    }
+    if (next_x < next_y) {
+      x += step_x;
+      next_x += delta_x;
+    } else {
+      y += step_y;
+      next_y += delta_y;
+    }
+    // rounding may step out of the grid before the last cell
+    if (x < 0 || x >= columns || y < 0 || y >= rows) {
+      break;
+    }
+  }
+  return crossed(x1, y1);
+}
+
+bool TravelPlanner::visible(const gp_XY &a, const gp_XY &b) const {
+  return !crosses(a, b) && inside((a + b) / 2);
+}
+
+bool TravelPlanner::visible(std::size_t i, std::size_t j) const {
+  auto &known = visibility[std::min(i, j) * nodes.size() + std::max(i, j)];
+  if (known == 0) {
+    known = visible(nodes[i], nodes[j]) ? 1 : 2;
+  }
+  return known == 1;
+}
+
+bool TravelPlanner::route(const gp_XY &a, const gp_XY &b, std::vector<gp_XY> &path) const {
+  path.clear();
+  if (visible(a, b)) {
+    path.push_back(b);
+    return true;
+  }
+  if (too_complex || nodes.empty()) {
+    return false;
+  }
+  // A* from a (index n) to b (index n + 1); edges are found lazily, as most
+  // routes only go around a few corners
+  const auto n = nodes.size();
+  const auto point = [&](std::size_t i) -> const gp_XY & {
+    return i < n ? nodes[i] : (i == n ? a : b);
+  };
+  auto cost = std::vector<double>(n + 2, std::numeric_limits<double>::max());
+  auto previous = std::vector<std::size_t>(n + 2, n + 2);
+  auto done = std::vector<bool>(n + 2, false);
+  using Item = std::pair<double, std::size_t>;
+  auto queue = std::priority_queue<Item, std::vector<Item>, std::greater<Item>>();
+  cost[n] = 0;
+  queue.emplace((b - a).Modulus(), n);
+  while (!queue.empty()) {
+    const auto current = queue.top().second;
+    queue.pop();
+    if (done[current]) {
+      continue;
+    }
+    if (current == n + 1) {
+      // walk back from b, without a itself
+      for (auto i = current; i != n; i = previous[i]) {
+        path.push_back(point(i));
+      }
+      std::reverse(path.begin(), path.end());
+      return true;
+    }
+    done[current] = true;
+    for (std::size_t next = 0; next < n + 2; ++next) {
+      if (done[next] || next == n) {
+        continue;
+      }
+      const double d = cost[current] + (point(next) - point(current)).Modulus();
+      if (d >= cost[next]) {
+        continue;
+      }
+      // between nodes, the visibility is shared by all the routes of the layer
+      const bool seen = current < n && next < n ? visible(current, next)
+                                                : visible(point(current), point(next));
+      if (seen) {
+        cost[next] = d;
+        previous[next] = current;
+        queue.emplace(d + (b - point(next)).Modulus(), next);
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace sse
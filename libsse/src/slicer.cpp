@@ -20,84 +20,724 @@
 
 namespace sse {
 
+// tool faces extend this far beyond the bounds of an object
+constexpr double TOOL_MARGIN = 1.0;
+// slices printed at heights closer than this are in the same layer
+constexpr double LAYER_TOLERANCE = 1e-6;
+
+// keys of a modifier: its volume, and the settings read per face, see
+// Slice::generate_shells(); the others apply to whole layers or objects
+const std::array<const char *, 3> MODIFIER_KEYS = {"file", "shells", "extrusion_width"};
+
+namespace {
+
+/**
+ * @brief Find the settings table of an object in the profile
+ * @param config Profile
+ * @param name Object name, i.e. its file name without extension
+ * @return objects."<name>" table, nullptr if there is none
+ */
+const toml::value *object_table(const toml::value &config, const std::string &name) {
+  // not a dotted lookup: file names may contain dots
+  if (name.empty() || !config.is_table()) {
+    return nullptr;
+  }
+  const auto objects = config.as_table().find("objects");
+  if (objects == config.as_table().end() || !objects->second.is_table()) {
+    return nullptr;
+  }
+  const auto it = objects->second.as_table().find(name);
+  if (it == objects->second.as_table().end() || !it->second.is_table()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+/**
+ * @struct Pass
+ * @brief What one extruder prints in a layer, in order
+ */
+struct Pass {
+  //! extruder, from 1
+  int extruder{1};
+  //! prime tower loops
+  std::vector<Contour> tower;
+  //! contours of the slices
+  std::vector<Contour> contours;
+  //! tolerance of each contour, from the settings of its slice
+  std::vector<double> tolerances;
+};
+
+} // namespace
+
 Slicer::Slicer(const fs::path configfile,
                const spdlog::level::level_enum loglevel)
-    : settings(Settings::getInstance()) {
-  // setup loggels
-  auto console_logger = spdlog::stdout_color_mt("console");
-  // auto error_logger = spdlog::stderr_color_mt("stderr");
-  spdlog::set_default_logger(console_logger);
+    // the logger isn't registered, so every job can have its own; stdout may
+    // carry the G-code
+    : logger(std::make_shared<spdlog::logger>(
+          "sse", std::make_shared<spdlog::sinks::stderr_color_sink_mt>())) {
   // TODO: maybe unnecessary
-  spdlog::flush_on(spdlog::level::info);
-  // set log level
-  spdlog::set_level(loglevel);
-  spdlog::debug("Logger initialized");
+  logger->flush_on(spdlog::level::info);
+  logger->set_level(loglevel);
+  logger->debug("Logger initialized");
   // parse settings
-  spdlog::debug("Initializing settings");
+  logger->debug("Initializing settings");
   settings.parse(configfile);
 }
 
+Slicer::Slicer(Settings settings, std::shared_ptr<spdlog::logger> logger)
+    : settings(std::move(settings)), logger(std::move(logger)) {}
+
 TopTools_ListOfShape Slicer::make_tools(const double layer_height,
-                                        const double object_height) {
-  spdlog::info("Creating splitter tools");
+                                        const Bnd_Box &bounds) {
   auto result = TopTools_ListOfShape{};
-  // create an unbounded plane, parallel to the xy plane,
-  // then convert it to a face
-  for (int i = 0; i < object_height / layer_height + 1; ++i) {
-    result.Append(BRepBuilderAPI_MakeFace(
-        gp_Pln(gp_Pnt(0, 0, i * layer_height), gp::DZ())));
+  if (bounds.IsVoid()) {
+    return result;
+  }
+  // bounds of the object, without the gap
+  Standard_Real xmin, ymin, zmin, xmax, ymax, zmax;
+  bounds.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+  const double gap = bounds.GetGap();
+  xmin += gap, ymin += gap, zmin += gap;
+  xmax -= gap, ymax -= gap, zmax -= gap;
+  // layers are on a common grid, so that the slices of different objects line
+  // up; only the layers within the Z range are created
+  const int first = static_cast<int>(std::ceil(zmin / layer_height));
+  const int last = static_cast<int>(std::floor(zmax / layer_height));
+  for (int i = first; i <= last; ++i) {
+    // a plane parallel to the xy plane, whose parameters are its X,Y
+    // coordinates
+    auto plane = gp_Pln(gp_Ax3(gp_Pnt(0, 0, i * layer_height), gp::DZ(), gp::DX()));
+    // bounded faces are much cheaper for the boolean than infinite planes
+    result.Append(BRepBuilderAPI_MakeFace(plane, xmin - TOOL_MARGIN, xmax + TOOL_MARGIN,
+                                          ymin - TOOL_MARGIN, ymax + TOOL_MARGIN)
+                      .Face());
   }
   return result;
 }
 
-TopoDS_Face make_spiral_face(const double height, const double layer_height) {
-  // make a unit cylinder, vertical axis, center @ (0,0), radius of 1
+TopoDS_Face Slicer::make_spiral_face(const gp_Pnt &center, const double radius,
+                                     const double height,
+                                     const double layer_height) {
+  if (radius <= 0 || height <= 0 || layer_height <= 0) {
+    throw std::runtime_error("Invalid spiral dimensions");
+  }
+  // cylinder with a vertical axis through the center, angle 0 along +X
   Handle_Geom_CylindricalSurface cylinder =
-      new Geom_CylindricalSurface(gp::XOY(), 1.0);
-  // TODO: center helix axis should be the central print axis
-  auto line = gp_Lin2d(gp::Origin2d(), gp_Dir2d(layer_height, 1.0));
-  Handle_Geom2d_TrimmedCurve segment = GCE2d_MakeSegment(line, 0.0, M_PI * 2.0);
-  // make the helixcal edge
-  auto helixEdge =
-      BRepBuilderAPI_MakeEdge(segment, cylinder, 0.0, 6.0 * M_PI).Edge();
-  auto wire = BRepBuilderAPI_MakeWire(helixEdge);
-  // make infinite line to sweep
-  auto profile = NULL;
-  // sweep line to create face
-  // auto face = GeomFill_Pipe();
-  // auto a = BRepOffsetAPI_MakePipe();
-  auto face = TopoDS_Face();
-
-  return face;
+      new Geom_CylindricalSurface(gp_Ax3(center, gp::DZ(), gp::DX()), radius);
+  // in the (angle, height) parameter space of the cylinder, a helix is a line
+  // rising one layer per turn
+  const double turns = height / layer_height;
+  Handle_Geom2d_Line line =
+      new Geom2d_Line(gp::Origin2d(), gp_Dir2d(2.0 * M_PI, layer_height));
+  const double length = turns * std::hypot(2.0 * M_PI, layer_height);
+  auto helix = BRepBuilderAPI_MakeEdge(line, cylinder, 0.0, length).Edge();
+  // the sweep needs a 3D curve; allow enough segments to follow every turn
+  BRepLib::BuildCurves3d(helix, 1.0e-6, GeomAbs_C1, 14,
+                         static_cast<int>(std::ceil(turns)) * 8);
+  auto spine = BRepBuilderAPI_MakeWire(helix).Wire();
+  // horizontal profile, from the start of the helix to the axis
+  auto start = gp_Pnt(center.X() + radius, center.Y(), center.Z());
+  auto profile =
+      BRepBuilderAPI_MakeWire(BRepBuilderAPI_MakeEdge(start, center).Edge()).Wire();
+  // a fixed vertical binormal keeps the profile horizontal along the sweep
+  auto pipe = BRepOffsetAPI_MakePipeShell(spine);
+  pipe.SetMode(gp::DZ());
+  pipe.Add(profile);
+  pipe.Build();
+  if (!pipe.IsDone()) {
+    throw std::runtime_error("Error sweeping spiral face");
+  }
+  auto exp = TopExp_Explorer(pipe.Shape(), TopAbs_FACE);
+  if (!exp.More()) {
+    throw std::runtime_error("Error sweeping spiral face: no face generated");
+  }
+  return TopoDS::Face(exp.Current());
+}
+
+std::vector<TopoDS_Wire>
+Slicer::slice_spiral(const std::vector<std::shared_ptr<Object>> &objects) {
+  double layer_height = settings.get_setting_fallback<double>("layer_height", 0.2);
+  auto result = std::vector<TopoDS_Wire>();
+  for (auto &o : objects) {
+    // bounds of the object, without the gap
+    Standard_Real xmin, ymin, zmin, xmax, ymax, zmax;
+    const auto &box = o->get_bound_box();
+    box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    const double gap = box.GetGap();
+    zmin += gap;
+    zmax -= gap;
+    // the first turn is printed one layer above the build plate
+    const auto center = gp_Pnt((xmin + xmax) / 2, (ymin + ymax) / 2, zmin + layer_height);
+    const double radius = std::hypot(xmax - xmin, ymax - ymin) / 2 + layer_height;
+    const double height = zmax - zmin - layer_height;
+    if (height <= 0) {
+      logger->warn("Spiral: object is thinner than one layer, skipping");
+      continue;
+    }
+    logger->debug("Spiral: sweeping helicoid, {} turns", height / layer_height);
+    auto face = make_spiral_face(center, radius, height, layer_height);
+
+    auto section = BRepAlgoAPI_Section(o->get_shape(), face, false);
+    section.SetRunParallel(true);
+    section.SetFuzzyValue(0.001);
+    section.Build();
+    if (section.HasErrors()) {
+      section.DumpErrors(std::cerr);
+      throw std::runtime_error("Error sectioning object with spiral");
+    }
+    // chain the section edges, which share their vertices
+    TopoDS_Shape wires;
+    BOPAlgo_Tools::EdgesToWires(section.Shape(), wires, true);
+    // the outer wall is the longest continuous path
+    auto best = TopoDS_Wire();
+    double best_length = 0;
+    for (auto it = TopExp_Explorer(wires, TopAbs_WIRE); it.More(); it.Next()) {
+      GProp_GProps props;
+      BRepGProp::LinearProperties(it.Current(), props);
+      if (props.Mass() > best_length) {
+        best_length = props.Mass();
+        best = TopoDS::Wire(it.Current());
+      }
+    }
+    if (best.IsNull()) {
+      logger->warn("Spiral: no intersection with object");
+      continue;
+    }
+    logger->debug("Spiral: toolpath length {:.1f}mm", best_length);
+    result.push_back(best);
+  }
+  return result;
+}
+
+std::unique_ptr<ToolSurface> Slicer::make_tool_surface(const Bnd_Box &bounds,
+                                                      const double layer_height) {
+  const auto type =
+      settings.get_setting_fallback<std::string>("slicing_surface", "planar");
+  if (type == "planar") {
+    return std::make_unique<PlanarToolSurface>(bounds, layer_height);
+  } else if (type == "conical") {
+    return std::make_unique<ConicalToolSurface>(
+        bounds, layer_height,
+        settings.get_setting_fallback<double>("slicing_angle", 15.0));
+  } else if (type == "spherical") {
+    return std::make_unique<SphericalToolSurface>(
+        bounds, layer_height,
+        settings.get_setting_fallback<double>("slicing_radius", 100.0));
+  }
+  throw std::runtime_error("Unknown slicing surface: " + type);
+}
+
+std::vector<SurfaceLayer>
+Slicer::slice_surfaces(const std::vector<std::shared_ptr<Object>> &objects) {
+  double layer_height = settings.get_setting_fallback<double>("layer_height", 0.2);
+  auto result = std::vector<SurfaceLayer>();
+  for (auto &o : objects) {
+    const auto tools = make_tool_surface(o->get_bound_box(), layer_height);
+    const auto &shape = o->get_shape();
+    logger->info("Slicing object with {} tool surfaces", tools->count());
+    auto layers = std::vector<SurfaceLayer>(tools->count());
+    auto failed = std::vector<char>(tools->count(), 0);
+    // every surface is independent: generate and intersect in parallel
+    OSD_Parallel::For(0, static_cast<int>(tools->count()), [&](const int i) {
+      layers[i].z = tools->height(i);
+      auto section = BRepAlgoAPI_Section(shape, tools->face(i), false);
+      // the object is shared between tasks, leave it untouched
+      section.SetNonDestructive(true);
+      section.SetFuzzyValue(0.001);
+      section.Build();
+      if (section.HasErrors()) {
+        failed[i] = 1;
+        return;
+      }
+      TopoDS_Shape wires;
+      BOPAlgo_Tools::EdgesToWires(section.Shape(), wires, true);
+      for (auto it = TopExp_Explorer(wires, TopAbs_WIRE); it.More(); it.Next()) {
+        layers[i].paths.push_back(TopoDS::Wire(it.Current()));
+      }
+    });
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+      throw std::runtime_error("Error sectioning object with tool surfaces");
+    }
+    // surfaces above or below the object
+    for (auto &l : layers) {
+      if (!l.paths.empty()) {
+        result.push_back(std::move(l));
+      }
+    }
+  }
+  // print layers of all objects bottom up
+  std::stable_sort(result.begin(), result.end(),
+                   [](const auto &lhs, const auto &rhs) { return lhs.z < rhs.z; });
+  return result;
+}
+
+std::string Slicer::generate_toolpaths(const std::vector<SurfaceLayer> &layers) {
+  auto writer = GCodeWriter(settings);
+  writer.create_header();
+  // maximum distance between the moves and the exact paths
+  const double tolerance = settings.get_setting_fallback<double>("tolerance", 0.01);
+  for (const auto &l : layers) {
+    writer.add_comment(fmt::format("layer z={:.3f}", l.z));
+    for (const auto &p : l.paths) {
+      writer.add_path(p, tolerance);
+    }
+  }
+  return writer.get_data();
+}
+
+std::vector<std::vector<int>>
+Slicer::schedule_extruders(const std::vector<std::vector<int>> &layers, int initial) {
+  auto result = std::vector<std::vector<int>>();
+  int current = initial;
+  for (std::size_t l = 0; l < layers.size(); ++l) {
+    auto remaining = layers[l];
+    std::sort(remaining.begin(), remaining.end());
+    remaining.erase(std::unique(remaining.begin(), remaining.end()), remaining.end());
+    auto order = std::vector<int>();
+    const auto take = [&](int e) {
+      order.push_back(e);
+      remaining.erase(std::find(remaining.begin(), remaining.end(), e));
+    };
+    // keep going with the current extruder
+    if (std::find(remaining.begin(), remaining.end(), current) != remaining.end()) {
+      take(current);
+    }
+    // end with an extruder the next layer starts with, if any
+    int last = 0;
+    if (l + 1 < layers.size()) {
+      for (const auto e : layers[l + 1]) {
+        if (std::find(remaining.begin(), remaining.end(), e) != remaining.end()) {
+          last = e;
+          break;
+        }
+      }
+    }
+    for (const auto e : std::vector<int>(remaining)) {
+      if (e != last) {
+        take(e);
+      }
+    }
+    if (last != 0) {
+      take(last);
+    }
+    if (!order.empty()) {
+      current = order.back();
+    }
+    result.push_back(std::move(order));
+  }
+  return result;
+}
+
+std::vector<std::vector<Slice *>>
+Slicer::layer_groups(const std::vector<std::unique_ptr<Slice>> &slices) {
+  auto groups = std::vector<std::vector<Slice *>>();
+  double group_z = 0;
+  for (const auto &s : slices) {
+    // slabs of different heights are printed at different heights, only
+    // slabs ending at the same height form a layer; the layers of an object
+    // are on a common grid, up to rounding
+    const double z = s->print_height();
+    if (groups.empty() || std::abs(z - group_z) > LAYER_TOLERANCE) {
+      groups.emplace_back();
+      group_z = z;
+    }
+    groups.back().push_back(s.get());
+  }
+  return groups;
+}
+
+std::vector<std::string>
+Slicer::generate_gcode(const std::vector<std::unique_ptr<Slice>> &slices) {
+  // follows the machine state from layer to layer, without rendering them
+  auto tracker = GCodeWriter(settings, GCodeWriter::State());
+  const double tolerance = settings.get_setting_fallback<double>("tolerance", 0.01);
+  // route travel moves inside each layer, retracting only to leave it
+  const bool combing = settings.get_setting_fallback<bool>("combing", true);
+  const double width = settings.get_setting_fallback<double>("extrusion_width", 0.4);
+  // order the paths of each pass to shorten travel
+  const bool optimize = settings.get_setting_fallback<bool>("path_optimization", true);
+  const int num_extruders = settings.get_setting_fallback<int>("printer.num_extruders", 1);
+
+  // the slices of all objects at the same height form a layer
+  const auto layers = layer_groups(slices);
+  auto used = std::vector<std::vector<int>>();
+  for (const auto &layer : layers) {
+    used.emplace_back();
+    for (const auto *s : layer) {
+      const int e = s->get_extruder();
+      if (e < 1 || e > num_extruders) {
+        throw std::runtime_error(fmt::format(
+            "Slicer: object assigned to extruder {}, the printer has {}", e, num_extruders));
+      }
+      used.back().push_back(e);
+    }
+  }
+  // order the regions of each layer by extruder, to minimize tool changes
+  const auto schedule = schedule_extruders(used, tracker.get_extruder());
+
+  // the prime tower purges each extruder after a tool change; it's printed on
+  // every layer up to the last tool change, so it stays continuous
+  std::size_t tower_layers = 0;
+  if (settings.get_setting_fallback<bool>("prime_tower", false)) {
+    int current = tracker.get_extruder();
+    for (std::size_t l = 0; l < schedule.size(); ++l) {
+      for (const auto e : schedule[l]) {
+        if (e != current) {
+          tower_layers = l + 1;
+          current = e;
+        }
+      }
+    }
+  }
+  const double tower_x = settings.get_setting_fallback<double>("prime_tower_x", 0.0);
+  const double tower_y = settings.get_setting_fallback<double>("prime_tower_y", 0.0);
+  const double tower_size = settings.get_setting_fallback<double>("prime_tower_size", 10.0);
+  // concentric squares, from the outside in
+  const int tower_loops = std::max(1, static_cast<int>(tower_size / (2 * width)));
+  const auto tower_loop = [&](int i, double z) {
+    const double inset = i * width;
+    const double x0 = tower_x + inset, y0 = tower_y + inset;
+    const double x1 = tower_x + tower_size - inset, y1 = tower_y + tower_size - inset;
+    auto c = Contour();
+    c.z = z;
+    c.move_to(gp_XY(x0, y0));
+    c.line_to(gp_XY(x1, y0));
+    c.line_to(gp_XY(x1, y1));
+    c.line_to(gp_XY(x0, y1));
+    c.line_to(gp_XY(x0, y0));
+    return c;
+  };
+
+  // plan every layer, and the machine state it starts from: it only depends
+  // on the tool changes before it and on where the previous layer ends, both
+  // known without rendering
+  auto plans = std::vector<std::vector<Pass>>(layers.size());
+  auto starts = std::vector<GCodeWriter::State>(layers.size());
+  auto position = tracker.get_state().position;
+  for (std::size_t l = 0; l < layers.size(); ++l) {
+    const double z = layers[l].front()->print_height();
+    starts[l] = tracker.get_state();
+
+    // the tower loops of the layer are shared between the extruders it
+    // switches to, or printed with the current extruder if there are none
+    auto purges = schedule[l];
+    if (purges.size() > 1 && purges.front() == tracker.get_extruder()) {
+      purges.erase(purges.begin());
+    }
+    const int slots = static_cast<int>(purges.size());
+    for (const auto e : schedule[l]) {
+      tracker.set_extruder(e);
+      auto pass = Pass();
+      pass.extruder = e;
+      const int slot = static_cast<int>(std::find(purges.begin(), purges.end(), e) - purges.begin());
+      if (l < tower_layers && slot < slots) {
+        for (int i = slot; i < tower_loops; i += slots) {
+          pass.tower.push_back(tower_loop(i, z));
+        }
+      }
+      for (const auto *s : layers[l]) {
+        if (s->get_extruder() != e) {
+          continue;
+        }
+        for (const auto &c : s->get_contours()) {
+          pass.contours.push_back(c);
+          pass.tolerances.push_back(s->get_settings().tolerance);
+        }
+      }
+      plans[l].push_back(std::move(pass));
+    }
+  }
+
+  // the tolerances go with their contours
+  const auto reorder = [](Pass &pass, const std::vector<std::size_t> &order) {
+    auto tolerances = std::vector<double>();
+    for (const auto i : order) {
+      tolerances.push_back(pass.tolerances[i]);
+    }
+    pass.tolerances = std::move(tolerances);
+  };
+  if (optimize) {
+    // the objects of each pass are ordered together, the costly part, in
+    // parallel; from the end of the tower, or a guess, see connect() below
+    OSD_Parallel::For(0, static_cast<int>(layers.size()), [&](const int l) {
+      for (auto &pass : plans[l]) {
+        auto order = std::vector<std::size_t>();
+        const auto from = pass.tower.empty() ? gp_XY(0, 0) : pass.tower.back().points.back();
+        PathOptimizer(from).sequence(pass.contours, &order);
+        reorder(pass, order);
+      }
+    });
+  }
+
+  // then, serially, each pass is joined to the end of the previous one, which
+  // is linear in its number of vertices
+  // the tool stops on the end of the last path printed
+  const auto follow = [&](const std::vector<Contour> &contours) {
+    for (auto c = contours.rbegin(); c != contours.rend(); ++c) {
+      if (!c->points.empty()) {
+        position = gp_XYZ(c->points.back().X(), c->points.back().Y(), c->z);
+        return;
+      }
+    }
+  };
+  for (std::size_t l = 0; l < layers.size(); ++l) {
+    starts[l].position = position;
+    for (auto &pass : plans[l]) {
+      follow(pass.tower);
+      if (optimize && !pass.contours.empty()) {
+        auto order = std::vector<std::size_t>(pass.contours.size());
+        std::iota(order.begin(), order.end(), 0);
+        PathOptimizer::connect(pass.contours, position.XY(), &order);
+        reorder(pass, order);
+      }
+      follow(pass.contours);
+    }
+  }
+
+  // render every layer on its own, then stitch them in order, after the header
+  logger->debug("rendering {} layers", layers.size());
+  auto chunks = std::vector<std::string>(layers.size() + 1);
+  auto header = GCodeWriter(settings, GCodeWriter::State());
+  header.create_header();
+  chunks.front() = header.take_data();
+  auto errors = std::vector<std::string>(layers.size());
+  OSD_Parallel::For(0, static_cast<int>(layers.size()), [&](const int l) {
+    try {
+      const double z = layers[l].front()->print_height();
+      auto writer = GCodeWriter(settings, starts[l]);
+      writer.add_comment(fmt::format("layer z={:.3f}", z));
+      // E is relative (M83, see create_header()); reset it anyway, so no layer
+      // depends on another
+      writer.reset_extrusion();
+      auto outlines = std::vector<Contour>();
+      if (combing) {
+        for (const auto *s : layers[l]) {
+          outlines.insert(outlines.end(), s->get_outlines().begin(), s->get_outlines().end());
+        }
+      }
+      auto planner = TravelPlanner(outlines, tolerance, width / 2);
+      writer.set_travel_planner(&planner);
+      for (const auto &pass : plans[l]) {
+        writer.set_extruder(pass.extruder);
+        if (!pass.tower.empty()) {
+          writer.add_comment("prime tower");
+        }
+        for (const auto &c : pass.tower) {
+          writer.add_contour(c, tolerance);
+        }
+        for (std::size_t i = 0; i < pass.contours.size(); ++i) {
+          writer.add_contour(pass.contours[i], pass.tolerances[i]);
+        }
+      }
+      writer.set_travel_planner(nullptr);
+      chunks[l + 1] = writer.take_data();
+    } catch (const std::exception &e) {
+      errors[l] = e.what();
+    }
+  });
+  for (const auto &e : errors) {
+    if (!e.empty()) {
+      throw std::runtime_error(e);
+    }
+  }
+  return chunks;
+}
+
+void Slicer::load_object_settings(Object &object, ImportCache &cache) {
+  const auto name = fs::path(object.get_filename()).stem().string();
+  const auto *table = object_table(settings.config, name);
+  if (table == nullptr) {
+    return;
+  }
+  logger->debug("loading settings of object {}", name);
+  object.set_overrides(*table);
+  const auto modifiers = Settings::find_setting<toml::array>(*table, "modifiers");
+  if (!modifiers) {
+    return;
+  }
+  const auto directory = settings.get_file().parent_path();
+  for (const auto &m : *modifiers) {
+    const auto file = Settings::find_setting<std::string>(m, "file");
+    if (!file) {
+      throw std::runtime_error("Object " + name + ": modifier without a file");
+    }
+    // e.g. a layer height can't change inside a region of a layer
+    for (const auto &[key, value] : m.as_table()) {
+      if (std::find_if(MODIFIER_KEYS.begin(), MODIFIER_KEYS.end(), [&](const char *k) {
+            return key == k;
+          }) == MODIFIER_KEYS.end()) {
+        throw std::runtime_error("Object " + name + ": modifier " + *file + ": setting " + key +
+                                 " doesn't apply to a region, only shells and "
+                                 "extrusion_width do");
+      }
+    }
+    // next to the profile, whatever the working directory of the process
+    auto path = fs::path(*file);
+    if (path.is_relative()) {
+      path = directory / path;
+    }
+    object.add_modifier(cache.shape(path.string()), m);
+  }
+}
+
+CompiledSettings Slicer::compile_settings(const Object &object,
+                                          const toml::value *region) const {
+  return CompiledSettings::compile(settings, {&object.get_overrides(), region});
+}
+
+void Slicer::apply_modifiers(const Object &object,
+                             const std::vector<std::unique_ptr<Slice>> &slices) const {
+  const auto modifiers = object.get_modifiers();
+  if (modifiers.empty()) {
+    return;
+  }
+  auto regions = std::vector<CompiledSettings>();
+  auto classifiers = std::vector<BRepClass3d_SolidClassifier>(modifiers.size());
+  for (std::size_t m = 0; m < modifiers.size(); ++m) {
+    regions.push_back(compile_settings(object, &modifiers[m].overrides));
+    classifiers[m].Load(modifiers[m].volume);
+  }
+  Handle(IntTools_Context) context = new IntTools_Context();
+  for (const auto &s : slices) {
+    // a point in the middle of the slab, off the cutting planes
+    const double lift = s->get_settings().layer_height / 2;
+    auto &faces = s->get_faces();
+    for (int i = 1; i <= faces.Length(); ++i) {
+      gp_Pnt p;
+      gp_Pnt2d uv;
+      if (BOPTools_AlgoTools3D::PointInFace(TopoDS::Face(faces.Value(i)), p, uv, context) != 0) {
+        continue;
+      }
+      p.SetZ(p.Z() + lift);
+      // the last modifier containing the face wins
+      for (auto m = modifiers.size(); m-- > 0;) {
+        classifiers[m].Perform(p, Precision::Confusion());
+        if (classifiers[m].State() == TopAbs_IN) {
+          s->set_face_settings(i, regions[m]);
+          break;
+        }
+      }
+    }
+  }
 }
 
 std::vector<std::unique_ptr<Slice>>
 Slicer::slice(const std::vector<std::shared_ptr<Object>> &objects) {
-  // find the highest z point of all objects
-  double z = 0;
-  auto obj = TopTools_ListOfShape();
-  // FIXME: optimize, we copy the shape to another list
-  for (auto o : objects) {
-    z = std::max(z, o->get_bound_box().CornerMax().Z());
-    obj.Append(o->get_shape());
+  // every object has its own settings, resolved once, so the slicing stages
+  // don't look up the profile
+  auto configs = std::vector<CompiledSettings>();
+  for (const auto &o : objects) {
+    configs.push_back(compile_settings(*o));
+    logger->debug("object {}: layer height {}", o->get_filename(), configs.back().layer_height);
   }
 
-  // FIXME more sane layer height fallback mechanism
-  double layer_height = settings.get_setting_fallback<double>("layer_height", 0.2);
-  // FIXME: for some reason, the following line results in std::bad_alloc, so cout instead
-  // spdlog::info("Layer Height: {}", layer_height);
-  std::cout << "layer height: " << layer_height << std::endl;
-  // create the slicing planes
-  spdlog::info("creating slicing planes");
-  auto tools = make_tools(layer_height, z);
+  // every object is sliced on its own, as an independent task, so that the
+  // cost of the boolean depends only on that object's complexity
+  logger->info("slicing {} objects", objects.size());
+  auto results = std::vector<std::vector<std::unique_ptr<Slice>>>(objects.size());
+  auto errors = std::vector<std::string>(objects.size());
+  OSD_Parallel::For(0, static_cast<int>(objects.size()), [&](const int i) {
+    const auto &config = configs[i];
+    try {
+      // sectioning only computes the outline of each layer, instead of 3D slabs
+      results[i] = config.sectioning ? section_object(*objects[i], config.layer_height)
+                                     : slice_object(*objects[i], config.layer_height);
+      std::stable_sort(results[i].begin(), results[i].end(),
+                       [](const auto &lhs, const auto &rhs) { return *lhs < *rhs; });
+      // the slices are printed by the extruder of their object, with its
+      // settings
+      for (auto &s : results[i]) {
+        s->set_extruder(objects[i]->get_extruder());
+        s->set_settings(config);
+      }
+      apply_modifiers(*objects[i], results[i]);
+      generate_layers(results[i]);
+    } catch (const std::exception &e) {
+      errors[i] = e.what();
+    }
+  });
+  for (const auto &e : errors) {
+    if (!e.empty()) {
+      throw std::runtime_error(e);
+    }
+  }
+
+  // merge the slices of all objects
+  auto slices = std::vector<std::unique_ptr<Slice>>();
+  for (auto &r : results) {
+    std::move(r.begin(), r.end(), std::back_inserter(slices));
+  }
+  // sort the slices by height, ascending
+  std::stable_sort(slices.begin(), slices.end(),
+                   [](const auto &lhs, const auto &rhs) { return *lhs < *rhs; });
+  logger->debug("number of slices: {}", slices.size());
+
+  return slices;
+}
+
+void Slicer::generate_layers(const std::vector<std::unique_ptr<Slice>> &slices) const {
+  if (slices.empty()) {
+    return;
+  }
+  const auto &config = slices.front()->get_settings();
+  logger->debug("generating shells");
+  OSD_Parallel::For(0, static_cast<int>(slices.size()),
+                    [&](const int i) { slices[i]->generate_shells(); });
+  // later stages work on contours, not on the topology
+  logger->debug("generating contours");
+  OSD_Parallel::For(0, static_cast<int>(slices.size()), [&](const int i) {
+    slices[i]->generate_contours(slices[i]->get_settings().tolerance);
+  });
+
+  // solid skins; an object may have several slices per layer, e.g. separate
+  // bodies. Only for the stages that fill them, the Clipper booleans are
+  // costly.
+  if (!settings.get_setting_fallback<bool>("detect_skins", false)) {
+    return;
+  }
+  logger->debug("detecting skins");
+  const auto groups = layer_groups(slices);
+  auto layers = std::vector<std::vector<Contour>>();
+  for (const auto &group : groups) {
+    layers.emplace_back();
+    for (const auto *s : group) {
+      const auto &outlines = s->get_outlines();
+      layers.back().insert(layers.back().end(), outlines.begin(), outlines.end());
+    }
+  }
+  const auto detector = SkinDetector(config.top_layers, config.bottom_layers,
+                                     config.tolerance, config.extrusion_width);
+  auto skins = detector.detect(layers);
+  OSD_Parallel::For(0, static_cast<int>(groups.size()), [&](const int i) {
+    if (groups[i].size() == 1) {
+      groups[i].front()->set_skin(std::move(skins[i]));
+      return;
+    }
+    // split the skin of the layer between its slices
+    for (auto *s : groups[i]) {
+      s->set_skin(SkinDetector::intersection(skins[i], s->get_outlines(), config.tolerance));
+    }
+  });
+}
+
+std::vector<std::unique_ptr<Slice>>
+Slicer::slice_object(Object &object, const double layer_height) {
+  // create the slicing planes over the object's bounds only
+  auto tools = make_tools(layer_height, object.get_bound_box());
+  auto arguments = TopTools_ListOfShape();
+  arguments.Append(object.get_shape());
+
   auto splitter = BRepAlgoAPI_Splitter{};
   // TODO: progress indicator using BRepAlgoAPI_Splitter::SetProgressIndicator
 
   // set the arguments
-  splitter.SetArguments(obj);
+  splitter.SetArguments(arguments);
   splitter.SetTools(tools);
   // run in parallel
   splitter.SetRunParallel(true);
+  // the object may be shared, leave it untouched
+  splitter.SetNonDestructive(true);
   // TODO: configurabe fuzzy value
   splitter.SetFuzzyValue(0.001);
   // run the algorithm
@@ -107,7 +747,7 @@ Slicer::slice(const std::vector<std::shared_ptr<Object>> &objects) {
     auto report = splitter.GetReport();
     report->Dump(std::cerr);
     // TODO: dump error to spdlog
-    spdlog::error("Error while splitting shape: ");
+    logger->error("Error while splitting shape: ");
     splitter.DumpErrors(std::cerr);
     // throw error
     throw std::runtime_error("Error splitting shapes");
@@ -125,46 +765,31 @@ Slicer::slice(const std::vector<std::shared_ptr<Object>> &objects) {
     auto a = copy.Shape();
     slices.push_back(std::make_unique<Slice>(a));
   }
-
-  // sort the slices by height, ascending
-  std::sort(slices.begin(), slices.end());
-  // debug output
-  spdlog::debug("number of slices: {}", slices.size());
-
-  int num_shells = settings.get_setting_fallback<int>("shells", 3);
-  double extrusion_width =
-      settings.get_setting_fallback<double>("extrusion_width", 0.4);
-  spdlog::debug("generating shells");
-  for (auto &s : slices) {
-    s->generate_shells(num_shells, 1.0);
-  }
-
   return slices;
 }
 
 void Slicer::dump_shapes(const std::vector<TopoDS_Shape> &shapes) {
-  spdlog::debug("--------Shape Dump-------");
+  logger->debug("--------Shape Dump-------");
   for (auto s : shapes) {
-    spdlog::debug(dump_recurse(s));
+    logger->debug(dump_recurse(s));
   }
-  spdlog::debug("-------------------------");
+  logger->debug("-------------------------");
 }
 
 void Slicer::dump_shapes(const TopoDS_Shape &shape) {
-  spdlog::debug("--------Shape Dump-------");
-  spdlog::debug(dump_recurse(shape));
-  spdlog::debug("-------------------------");
+  logger->debug("--------Shape Dump-------");
+  logger->debug(dump_recurse(shape));
+  logger->debug("-------------------------");
 }
 
-std::string Slicer::dump_recurse(const TopoDS_Shape &shape) {
+std::string Slicer::dump_recurse(const TopoDS_Shape &shape, int depth) {
   // temporary string for return value
   std::string result;
-  // prepend info with tree characters
-  static int indent_level = 0;
-  // construct prepend string based in indentation level
+  // prepend info with tree characters, based on the depth; not a static
+  // counter, jobs may dump shapes concurrently
   std::string prepend;
-  for (int i = 0; i < indent_level; ++i) {
-    prepend += (i < indent_level - 1 ? "|\t" : "├─ ");
+  for (int i = 0; i < depth; ++i) {
+    prepend += (i < depth - 1 ? "|\t" : "├─ ");
   }
 
   // TODO: provide more information
@@ -172,47 +797,105 @@ std::string Slicer::dump_recurse(const TopoDS_Shape &shape) {
 
   // if shape has sub-shapes, recurse
   if (shape.ShapeType() == TopAbs_COMPOUND) {
-    // increase indentation level for subtree
-    indent_level++;
+    // the subtree is one level deeper
     for (auto it = TopoDS_Iterator(shape); it.More(); it.Next()) {
       // special character for final entry in list
-      result += dump_recurse(it.Value());
+      result += dump_recurse(it.Value(), depth + 1);
     }
-    // when subtree is exhausted, decrement indentation level
-    indent_level--;
   }
 
   return result;
 }
 
-void Slicer::section(const TopTools_ListOfShape &objects,
-                     const TopTools_ListOfShape &tools) {
-  BOPAlgo_Section section;
-  // get first object
-  TopoDS_Shape object = objects.First();
-
-  TopTools_ListOfShape result;
+std::vector<std::unique_ptr<Slice>>
+Slicer::section_object(Object &object, const double layer_height) {
+  const auto &shape = object.get_shape();
+  auto planes = std::vector<TopoDS_Shape>();
+  for (const auto &t : make_tools(layer_height, object.get_bound_box())) {
+    planes.push_back(t);
+  }
 
-  for (auto face : tools) {
-    // section object
-    section.AddArgument(object);
-    section.AddArgument(face);
-    // section.BuildSection();
-    result = section.Generated(object);
+  auto slices = std::vector<std::unique_ptr<Slice>>(planes.size());
+  auto failed = std::vector<char>(planes.size(), 0);
+  // every layer is independent: section in parallel
+  OSD_Parallel::For(0, static_cast<int>(planes.size()), [&](const int i) {
+    auto section = BRepAlgoAPI_Section(shape, planes[i], false);
+    // the object is shared between tasks, leave it untouched
+    section.SetNonDestructive(true);
+    section.SetFuzzyValue(0.001);
+    section.Build();
+    if (section.HasErrors()) {
+      failed[i] = 1;
+      return;
+    }
+    // chain the section edges into closed outlines, then fill them
+    TopoDS_Shape wires, faces;
+    BOPAlgo_Tools::EdgesToWires(section.Shape(), wires, true);
+    if (!BOPAlgo_Tools::WiresToFaces(wires, faces)) {
+      return;
+    }
+    // holes are filled too: keep only faces with material right above them,
+    // i.e. the bottom of the layer; the classifier explores the solid once,
+    // then tests a point of each face
+    Handle(IntTools_Context) context = new IntTools_Context();
+    auto classifier = BRepClass3d_SolidClassifier();
+    classifier.Load(shape);
+    auto layer_faces = TopTools_ListOfShape();
+    for (auto exp = TopExp_Explorer(faces, TopAbs_FACE); exp.More(); exp.Next()) {
+      const auto &face = TopoDS::Face(exp.Current());
+      gp_Pnt p;
+      gp_Pnt2d uv;
+      if (BOPTools_AlgoTools3D::PointInFace(face, p, uv, context) != 0) {
+        continue;
+      }
+      p.SetZ(p.Z() + layer_height / 10);
+      classifier.Perform(p, Precision::Confusion());
+      if (classifier.State() == TopAbs_IN) {
+        layer_faces.Append(face);
+      }
+    }
+    if (!layer_faces.IsEmpty()) {
+      slices[i] = std::make_unique<Slice>(layer_faces);
+    }
+  });
+  if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+    throw std::runtime_error("Error sectioning object");
   }
+  // layers without material
+  slices.erase(std::remove(slices.begin(), slices.end(), nullptr), slices.end());
+  return slices;
 }
 
 void Slicer::arrange_objects(std::vector<std::shared_ptr<Object>> objects) {
-  spdlog::debug("Creating Bin Packer");
+  // build plate dimensions; circular plates are described by their diameter
+  const bool is_circle =
+      settings.get_setting_fallback<bool>("printer.build_plate.is_circle", false);
+  const double build_plate_size =
+      settings.get_setting_fallback<double>("printer.build_plate.size", 200.0);
+  double build_plate_x = build_plate_size, build_plate_y = build_plate_size;
+  // nest objects by their real outline instead of their bounding box; on a
+  // circular plate, the nester places them in rings around the center, where
+  // a rectangular bin would waste the edge of the plate
+  if (is_circle ||
+      settings.get_setting_fallback<std::string>("packing", "bounding_box") == "outline") {
+    logger->debug("Creating Nester");
+    auto nester = Nester(objects, build_plate_x, build_plate_y,
+                         settings.get_setting_fallback<double>("packing_spacing", 5.0),
+                         1.0, is_circle);
+    // throws if an object doesn't fit on the build plate
+    nester.nest();
+    nester.arrange();
+    return;
+  }
+
+  logger->debug("Creating Bin Packer");
   auto packer = Packer(objects);
   // pack the objects, get dimensions of resulting bin
   auto [width, length] = packer.pack();
   // check to see if the pack fit within the build plate
-  // FIXME: get actual buildplate volume/dimensions
-  double build_plate_x = 200, build_plate_y = 200;
-  spdlog::debug("BinPack: comparing resulting bin to build plate size");
+  logger->debug("BinPack: comparing resulting bin to build plate size");
   if (width > build_plate_x || length > build_plate_y) {
-    spdlog::debug("BinPack error: packed volume exceeds build plate");
+    logger->debug("BinPack error: packed volume exceeds build plate");
     throw std::runtime_error("Bin Packing error: bin exceeds build plate");
   }
   // calculate the offset necessary for centering the pack on the build plate
@@ -222,6 +905,21 @@ void Slicer::arrange_objects(std::vector<std::shared_ptr<Object>> objects) {
   packer.arrange(offset_x, offset_y);
 }
 
+void Slicer::orient_objects(std::vector<std::shared_ptr<Object>> objects) {
+  const double layer_height = settings.get_setting<double>("layer_height");
+  const double overhang_angle =
+      settings.get_setting_fallback<double>("overhang_angle", 45.0);
+  auto weights = Orienter::Weights();
+  weights.overhang = settings.get_setting_fallback<double>("orient_overhang", weights.overhang);
+  weights.contact = settings.get_setting_fallback<double>("orient_contact", weights.contact);
+  weights.height = settings.get_setting_fallback<double>("orient_height", weights.height);
+  for (auto &o : objects) {
+    // candidates are scored in parallel within each object
+    auto orienter = Orienter(*o, layer_height, overhang_angle, weights);
+    orienter.orient();
+  }
+}
+
 void Slicer::make_build_volume() {
   // get build volume from settings
 }
@@ -1,2 +1,192 @@
 #include <OSD_PerfMeter.hxx>
 #include <OSD.hxx>
+
+#include <sse/Importer.hpp>
+#include <sse/slicer.hpp>
+
+#include <BRepAlgoAPI_Splitter.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepTools.hxx>
+#include <Bnd_Box.hxx>
+#include <TopExp_Explorer.hxx>
+#include <TopTools_ListOfShape.hxx>
+#include <gp_Pln.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+// number of repetitions of each measurement
+constexpr int REPETITIONS = 20;
+// layer height of the splitter benchmark
+constexpr double LAYER_HEIGHT = 0.2;
+
+/**
+ * @brief Measure the average run time of a function
+ * @param f Function to measure
+ * @param repetitions Number of runs to average
+ * @return average time, in microseconds
+ */
+double measure(const std::function<void()> &f, int repetitions = REPETITIONS) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repetitions; ++i) {
+    f();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() /
+         repetitions;
+}
+
+/**
+ * @brief Volume of a bounding box, without its gap
+ */
+double volume(const Bnd_Box &b) {
+  if (b.IsVoid()) {
+    return 0;
+  }
+  Standard_Real xmin, ymin, zmin, xmax, ymax, zmax;
+  b.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+  const double g = 2 * b.GetGap();
+  return (xmax - xmin - g) * (ymax - ymin - g) * (zmax - zmin - g);
+}
+
+/**
+ * @brief Bounding box cost benchmark
+ *
+ * For every model in resources/, measure the cost of each bounding box mode,
+ * and how loose it is compared to the optimal bounding box.
+ */
+void bounding_box_benchmark(const std::vector<fs::path> &models) {
+  std::cout << "model, mode, time (us), volume / optimal volume\n";
+  auto importer = sse::Importer();
+  for (const auto &model : models) {
+    auto shape = importer.import(model.string());
+    auto name = model.filename().string();
+
+    // bounds from the exact geometry
+    BRepTools::Clean(shape);
+    Bnd_Box optimal;
+    auto optimal_time = measure([&]() {
+      optimal.SetVoid();
+      BRepBndLib::AddOptimal(shape, optimal, false);
+    });
+    Bnd_Box fast;
+    auto fast_time = measure([&]() {
+      fast.SetVoid();
+      BRepBndLib::Add(shape, fast, false);
+    });
+
+    // bounds from the triangulation, i.e. once an object has been meshed
+    auto mesh = BRepMesh_IncrementalMesh(shape, 0.1);
+    Bnd_Box meshed;
+    auto meshed_time = measure([&]() {
+      meshed.SetVoid();
+      BRepBndLib::Add(shape, meshed, true);
+    });
+    Bnd_Box meshed_optimal;
+    auto meshed_optimal_time = measure([&]() {
+      meshed_optimal.SetVoid();
+      BRepBndLib::AddOptimal(shape, meshed_optimal, true);
+    });
+
+    const auto reference = volume(optimal);
+    auto print = [&](const std::string &mode, double time, const Bnd_Box &b) {
+      std::cout << fmt::format("{}, {}, {:.1f}, {:.4f}\n", name, mode, time,
+                               reference > 0 ? volume(b) / reference : 0.0);
+    };
+    print("Add", fast_time, fast);
+    print("AddOptimal", optimal_time, optimal);
+    print("Add (triangulation)", meshed_time, meshed);
+    print("AddOptimal (triangulation)", meshed_optimal_time, meshed_optimal);
+  }
+}
+
+/**
+ * @brief Split a shape with a set of tools
+ * @return number of resulting solids
+ */
+int split(const TopoDS_Shape &shape, const TopTools_ListOfShape &tools) {
+  auto arguments = TopTools_ListOfShape();
+  arguments.Append(shape);
+  auto splitter = BRepAlgoAPI_Splitter();
+  splitter.SetArguments(arguments);
+  splitter.SetTools(tools);
+  splitter.SetRunParallel(true);
+  splitter.SetFuzzyValue(0.001);
+  splitter.Build();
+  int count = 0;
+  for (auto it = TopExp_Explorer(splitter.Shape(), TopAbs_SOLID); it.More(); it.Next()) {
+    ++count;
+  }
+  return count;
+}
+
+/**
+ * @brief Slicing tools benchmark
+ *
+ * For every model in resources/, compare the cost of splitting it with
+ * unbounded planes from Z=0 (the former tool set) to planes bounded to the
+ * model, as made by Slicer::make_tools from the bounds of the object, as the
+ * slicer does, and to sectioning it with the same planes
+ * ("slicing_mode = section").
+ */
+void splitter_benchmark(const std::vector<fs::path> &models) {
+  std::cout << "model, tools, time (ms), slices\n";
+  auto importer = sse::Importer();
+  for (const auto &model : models) {
+    auto shape = importer.import(model.string());
+    auto name = model.filename().string();
+    auto object = sse::Object(shape);
+    const auto &bounds = object.get_bound_box();
+
+    auto unbounded = TopTools_ListOfShape();
+    for (int i = 0; i < (bounds.CornerMax().Z() - bounds.GetGap()) / LAYER_HEIGHT + 1; ++i) {
+      unbounded.Append(BRepBuilderAPI_MakeFace(
+          gp_Pln(gp_Pnt(0, 0, i * LAYER_HEIGHT), gp::DZ())));
+    }
+    auto bounded = sse::Slicer::make_tools(LAYER_HEIGHT, bounds);
+
+    int count = 0;
+    auto print = [&](const std::string &tools, double time) {
+      std::cout << fmt::format("{}, {}, {:.1f}, {}\n", name, tools, time / 1000, count);
+    };
+    print("unbounded", measure([&]() { count = split(shape, unbounded); }, 3));
+    print("bounded", measure([&]() { count = split(shape, bounded); }, 3));
+    auto slicer = sse::Slicer(sse::Settings(), spdlog::default_logger());
+    print("section", measure([&]() {
+            count = static_cast<int>(slicer.section_object(object, LAYER_HEIGHT).size());
+          }, 3));
+  }
+}
+
+int main(int argc, char **argv) {
+  spdlog::set_level(spdlog::level::warn);
+  // models to measure, all STEP files in resources/ by default
+  auto models = std::vector<fs::path>();
+  for (int i = 1; i < argc; ++i) {
+    models.emplace_back(argv[i]);
+  }
+  if (models.empty()) {
+    for (const auto &entry : fs::directory_iterator(SSE_RESOURCE_DIR)) {
+      if (entry.path().extension() == ".step") {
+        models.push_back(entry.path());
+      }
+    }
+    std::sort(models.begin(), models.end());
+  }
+
+  bounding_box_benchmark(models);
+  splitter_benchmark(models);
+
+  return 0;
+}
@@ -0,0 +1,33 @@
+#include <doctest/doctest.h>
+
+#include <sse/CompiledSettings.hpp>
+
+TEST_CASE("Compiled settings layering test") {
+  auto settings = sse::Settings();
+  settings.config = toml::table{{"layer_height", 0.3}, {"shells", 2}, {"infill_density", 0.2}};
+
+  SUBCASE("global") {
+    const auto s = sse::CompiledSettings::compile(settings);
+    CHECK(s.layer_height == doctest::Approx(0.3));
+    CHECK(s.shells == 2);
+    // missing settings take their defaults
+    CHECK(s.extrusion_width == doctest::Approx(0.4));
+    CHECK_FALSE(s.sectioning);
+  }
+
+  SUBCASE("the most specific override wins") {
+    const toml::value object = toml::table{{"shells", 4}, {"slicing_mode", "section"}};
+    // integers are valid floating point settings
+    const toml::value region = toml::table{{"shells", 6}, {"infill_density", 1}};
+    const auto s = sse::CompiledSettings::compile(settings, {&object, nullptr, &region});
+    CHECK(s.layer_height == doctest::Approx(0.3));
+    CHECK(s.shells == 6);
+    CHECK(s.infill_density == doctest::Approx(1.0));
+    CHECK(s.sectioning);
+  }
+
+  SUBCASE("invalid values") {
+    const toml::value object = toml::table{{"layer_height", 0}};
+    CHECK_THROWS_AS(sse::CompiledSettings::compile(settings, {&object}), std::runtime_error);
+  }
+}
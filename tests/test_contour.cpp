@@ -0,0 +1,110 @@
+#include <doctest/doctest.h>
+
+#include <sse/Contour.hpp>
+
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_MakeWire.hxx>
+#include <Geom_BezierCurve.hxx>
+#include <TColgp_Array1OfPnt.hxx>
+#include <gp_Ax2.hxx>
+
+TEST_CASE("Contour from wire test") {
+  SUBCASE("polygon") {
+    auto polygon = BRepBuilderAPI_MakePolygon(gp_Pnt(0, 0, 2), gp_Pnt(10, 0, 2),
+                                              gp_Pnt(10, 20, 2), gp_Pnt(0, 20, 2), true);
+    auto c = sse::Contour::from_wire(polygon.Wire(), 0.01);
+    CHECK(c.size() == 4);
+    CHECK(c.closed());
+    CHECK(c.z == doctest::Approx(2.0));
+    CHECK(c.length() == doctest::Approx(60.0));
+    for (const auto s : c.segments) {
+      CHECK(s == sse::Contour::Segment::Line);
+    }
+  }
+
+  SUBCASE("circle") {
+    auto circle = gp_Circ(gp_Ax2(gp_Pnt(5, 5, 1), gp::DZ()), 10);
+    auto wire = BRepBuilderAPI_MakeWire(BRepBuilderAPI_MakeEdge(circle).Edge()).Wire();
+    auto c = sse::Contour::from_wire(wire, 0.01);
+    // full circles are split in two arcs
+    REQUIRE(c.size() == 2);
+    CHECK(c.closed());
+    CHECK(c.segments[0] == sse::Contour::Segment::ArcCCW);
+    CHECK(c.centers[0].X() == doctest::Approx(5.0));
+    CHECK(c.centers[0].Y() == doctest::Approx(5.0));
+    CHECK(c.length() == doctest::Approx(2 * M_PI * 10));
+
+    // every vertex of the discretized circle is on the circle, and every chord
+    // is within the tolerance
+    auto points = c.flatten(0.01);
+    CHECK(points.size() > 3);
+    // adaptive: a coarser tolerance needs fewer points
+    CHECK(c.flatten(0.1).size() < points.size());
+    for (std::size_t i = 1; i < points.size(); ++i) {
+      CHECK((points[i] - gp_XY(5, 5)).Modulus() == doctest::Approx(10.0));
+      auto middle = (points[i] + points[i - 1]) / 2;
+      CHECK(10.0 - (middle - gp_XY(5, 5)).Modulus() <= 0.01 + 1e-9);
+    }
+  }
+
+  SUBCASE("bezier") {
+    TColgp_Array1OfPnt poles(1, 4);
+    poles(1) = gp_Pnt(0, 0, 1);
+    poles(2) = gp_Pnt(0, 10, 1);
+    poles(3) = gp_Pnt(10, 10, 1);
+    poles(4) = gp_Pnt(10, 0, 1);
+    Handle(Geom_BezierCurve) bezier = new Geom_BezierCurve(poles);
+    auto wire = BRepBuilderAPI_MakeWire(BRepBuilderAPI_MakeEdge(bezier).Edge()).Wire();
+    auto c = sse::Contour::from_wire(wire, 0.01);
+    // kept exact, as a single cubic segment
+    REQUIRE(c.size() == 1);
+    CHECK(c.segments[0] == sse::Contour::Segment::Cubic);
+    CHECK_FALSE(c.cubic(0).rational());
+    CHECK(c.cubic(0).controls[0].Y() == doctest::Approx(10.0));
+    const auto middle = c.evaluate(0, 0.5);
+    CHECK(middle.X() == doctest::Approx(5.0));
+    CHECK(middle.Y() == doctest::Approx(7.5));
+    auto points = c.flatten(0.01);
+    CHECK(points.size() > 3);
+    // adaptive: a coarser tolerance needs fewer points
+    CHECK(c.flatten(0.1).size() < points.size());
+    CHECK(points.back().IsEqual(gp_XY(10, 0), Precision::Confusion()));
+  }
+
+  SUBCASE("flat bezier") {
+    // collinear control points: a single line is exact
+    auto c = sse::Contour();
+    c.move_to(gp_XY(0, 0));
+    auto cubic = sse::Contour::Cubic();
+    cubic.controls = {gp_XY(3, 0), gp_XY(6, 0)};
+    c.cubic_to(gp_XY(10, 0), cubic);
+    CHECK(c.flatten(0.01).size() == 2);
+  }
+}
+
+TEST_CASE("Contour direction test") {
+  // half circle, closed by its diameter
+  auto c = sse::Contour();
+  c.move_to(gp_XY(10, 0));
+  c.arc_to(gp_XY(-10, 0), gp_XY(0, 0), true);
+  c.line_to(gp_XY(10, 0));
+  const double length = c.length();
+
+  SUBCASE("reverse") {
+    c.reverse();
+    CHECK(c.segments[0] == sse::Contour::Segment::Line);
+    CHECK(c.segments[1] == sse::Contour::Segment::ArcCW);
+    CHECK(c.sweep(1) == doctest::Approx(-M_PI));
+    CHECK(c.length() == doctest::Approx(length));
+  }
+
+  SUBCASE("rotate") {
+    c.rotate(1);
+    CHECK(c.closed());
+    CHECK(c.points.front().IsEqual(gp_XY(-10, 0), Precision::Confusion()));
+    CHECK(c.segments[1] == sse::Contour::Segment::ArcCCW);
+    CHECK(c.centers[1].IsEqual(gp_XY(0, 0), Precision::Confusion()));
+    CHECK(c.length() == doctest::Approx(length));
+  }
+}
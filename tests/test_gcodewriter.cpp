@@ -0,0 +1,302 @@
+#include <doctest/doctest.h>
+
+#include <sse/GCodeWriter.hpp>
+
+#include <GC_MakeArcOfCircle.hxx>
+#include <gp_Ax2.hxx>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+
+int count(const std::string &data, const std::string &word) {
+  int result = 0;
+  for (auto i = data.find(word); i != std::string::npos; i = data.find(word, i + 1)) {
+    ++result;
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("GCodeWriter arc test") {
+  // full circle, radius 10, centered on 5,5, starting on 15,5
+  auto c = sse::Contour();
+  c.z = 0.2;
+  c.move_to(gp_XY(15, 5));
+  c.arc_to(gp_XY(-5, 5), gp_XY(5, 5), true);
+  c.arc_to(gp_XY(15, 5), gp_XY(5, 5), true);
+  auto settings = sse::Settings();
+
+  SUBCASE("arc moves") {
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(c, 0.01);
+    const auto data = w.get_data();
+    CHECK(count(data, "G3") == 2);
+    CHECK(count(data, "G2") == 0);
+    CHECK(count(data, "G1") == 0);
+    // center relative to the start of the first arc
+    CHECK(data.find("G3 X-5.000 Y5.000 I-10.000 J0.000") != std::string::npos);
+    // extrusion along half the circumference
+    CHECK(data.find(fmt::format("E{:.5f}", M_PI * 10)) != std::string::npos);
+  }
+
+  SUBCASE("clockwise") {
+    auto cw = sse::Contour();
+    // quarter turn, from +X to -Y of the center
+    cw.move_to(gp_XY(15, 5));
+    cw.arc_to(gp_XY(5, -5), gp_XY(5, 5), false);
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(cw, 0.01);
+    CHECK(count(w.get_data(), "G2") == 1);
+    CHECK(w.get_data().find("G2 X5.000 Y-5.000 I-10.000 J0.000") != std::string::npos);
+  }
+
+  SUBCASE("line segments") {
+    settings.config = toml::table{{"arc_moves", false}};
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(c, 0.01);
+    CHECK(count(w.get_data(), "G3") == 0);
+    CHECK(count(w.get_data(), "G1") > 4);
+  }
+
+  SUBCASE("trimmed curve") {
+    // a quarter of a circle, radius 5 about the origin, as BRep_Tool::Curve()
+    // returns for an arc edge
+    const auto circle = gp_Circ(gp_Ax2(gp_Pnt(0, 0, 0.2), gp::DZ()), 5);
+    const Handle(Geom_TrimmedCurve) arc = GC_MakeArcOfCircle(circle, 0, M_PI / 2, true).Value();
+    auto w = sse::GCodeWriter(settings);
+    const auto moves = w.add_segment(arc);
+    // the moves are returned and added to the program, within the trim
+    CHECK(moves == w.get_data());
+    CHECK(count(moves, "G3") == 1);
+    CHECK(moves.find("G3 X0.000 Y5.000 I-5.000 J0.000") != std::string::npos);
+  }
+
+  SUBCASE("reversed edge") {
+    const auto circle = gp_Circ(gp_Ax2(gp_Pnt(0, 0, 0.2), gp::DZ()), 5);
+    auto edge = BRepBuilderAPI_MakeEdge(circle, 0, M_PI / 2).Edge();
+    edge.Reverse();
+    auto w = sse::GCodeWriter(settings);
+    const auto moves = w.add_edge(edge);
+    // from the end of the arc back to its start, clockwise
+    CHECK(count(moves, "G2") == 1);
+    CHECK(moves.find("G2 X5.000 Y0.000 I0.000 J-5.000") != std::string::npos);
+  }
+}
+
+TEST_CASE("GCodeWriter spline test") {
+  auto c = sse::Contour();
+  c.z = 0.2;
+  c.move_to(gp_XY(0, 0));
+  auto cubic = sse::Contour::Cubic();
+  cubic.controls = {gp_XY(0, 10), gp_XY(10, 10)};
+  c.cubic_to(gp_XY(10, 0), cubic);
+
+  auto settings = sse::Settings();
+
+  SUBCASE("bezier") {
+    settings.config = toml::table{{"spline_moves", "G5"}};
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(c, 0.01);
+    // I,J relative to the start, P,Q relative to the end
+    CHECK(w.get_data().find("G5 X10.000 Y0.000 I0.000 J10.000 P0.000 Q10.000") !=
+          std::string::npos);
+    CHECK(count(w.get_data(), "G1") == 0);
+  }
+
+  SUBCASE("nurbs") {
+    settings.config = toml::table{{"spline_moves", "G5.2"}};
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(c, 0.01);
+    CHECK(count(w.get_data(), "G5.2") == 1);
+    CHECK(count(w.get_data(), "G5.3") == 1);
+    CHECK(count(w.get_data(), " P1.00000") == 4);
+  }
+
+  SUBCASE("rational bezier") {
+    settings.config = toml::table{{"spline_moves", "G5"}};
+    c.cubics.front().weights = {1, 2, 2, 1};
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(c, 0.01);
+    // G5 is polynomial only
+    CHECK(count(w.get_data(), "G5") == 0);
+    CHECK(count(w.get_data(), "G1") > 2);
+  }
+
+  SUBCASE("line segments") {
+    settings.config = toml::table{};
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(c, 0.01);
+    CHECK(count(w.get_data(), "G5") == 0);
+    CHECK(count(w.get_data(), "G1") > 2);
+  }
+
+}
+
+TEST_CASE("GCodeWriter minimum segment length test") {
+  // 100 lines of 0.1 mm, along a gentle zigzag
+  auto c = sse::Contour();
+  c.move_to(gp_XY(0, 0));
+  for (int i = 1; i <= 100; ++i) {
+    c.line_to(gp_XY(i * 0.1, (i % 2) * 0.001));
+  }
+  auto settings = sse::Settings();
+  settings.config = toml::table{{"min_segment_length", 0.45}};
+  auto w = sse::GCodeWriter(settings);
+  w.add_contour(c, 0.01);
+  const auto data = w.get_data();
+  CHECK(count(data, "G1") == 20);
+  // the last move ends on the end of the contour
+  const auto last = data.rfind("G1");
+  CHECK(data.find("X10.000", last) != std::string::npos);
+}
+
+TEST_CASE("GCodeWriter minimum segment length detail test") {
+  // zigzag of 0.01 mm steps, below the minimum segment length of the profile
+  const auto zigzag = [](double amplitude) {
+    auto c = sse::Contour();
+    c.move_to(gp_XY(0, 0));
+    for (int i = 1; i <= 100; ++i) {
+      c.line_to(gp_XY(i * 0.01, (i % 2) * amplitude));
+    }
+    return c;
+  };
+  auto settings = sse::Settings();
+  settings.config = toml::table{{"min_segment_length", 0.05}};
+
+  SUBCASE("beyond the tolerance") {
+    // merging the teeth would cut them by three times the tolerance
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(zigzag(0.03), 0.01);
+    CHECK(count(w.get_data(), "G1") == 100);
+  }
+
+  SUBCASE("within the tolerance") {
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(zigzag(0.002), 0.01);
+    CHECK(count(w.get_data(), "G1") == 20);
+  }
+}
+
+TEST_CASE("GCodeWriter travel test") {
+  // two squares on the same layer
+  auto square = [](double x) {
+    auto c = sse::Contour();
+    c.z = 0.2;
+    c.move_to(gp_XY(x, 0));
+    c.line_to(gp_XY(x + 10, 0));
+    c.line_to(gp_XY(x + 10, 10));
+    c.line_to(gp_XY(x, 10));
+    c.line_to(gp_XY(x, 0));
+    return c;
+  };
+  const auto first = square(0), second = square(20);
+  auto settings = sse::Settings();
+  settings.config = toml::table{
+      {"printer", toml::table{{"extruder_1", toml::table{{"retraction_distance", 1.0}}}}}};
+
+  SUBCASE("inside") {
+    // the inner loop is inside the outline: no retraction
+    auto inner = first;
+    for (auto &p : inner.points) {
+      p = gp_XY(2, 2) + p * 0.5;
+    }
+    const auto planner = sse::TravelPlanner({first}, 0.01);
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(first, 0.01);
+    w.set_travel_planner(&planner);
+    const auto begin = w.get_data().size();
+    w.add_contour(inner, 0.01);
+    CHECK(count(w.get_data().substr(begin), "E-") == 0);
+  }
+
+  SUBCASE("between islands") {
+    const auto planner = sse::TravelPlanner({first, second}, 0.01);
+    auto w = sse::GCodeWriter(settings);
+    w.add_contour(first, 0.01);
+    w.set_travel_planner(&planner);
+    const auto begin = w.get_data().size();
+    w.add_contour(second, 0.01);
+    // retract, travel, prime
+    CHECK(count(w.get_data().substr(begin), "G1 E-1.00000") == 1);
+    CHECK(count(w.get_data().substr(begin), "G1 E1.00000") == 1);
+  }
+
+}
+
+TEST_CASE("GCodeWriter extruder test") {
+  auto settings = sse::Settings();
+  settings.config = toml::table{
+      {"printer",
+       toml::table{{"extruder_1", toml::table{{"retraction_distance", 1.0},
+                                              {"extrusion_speed", 50}}},
+                   {"extruder_2", toml::table{{"retraction_distance", 2.0},
+                                              {"extrusion_speed", 20}}}}}};
+  auto c = sse::Contour();
+  c.move_to(gp_XY(0, 0));
+  c.line_to(gp_XY(10, 0));
+
+  auto w = sse::GCodeWriter(settings);
+  w.add_contour(c, 0.01);
+  w.set_extruder(2);
+  // no change
+  w.set_extruder(2);
+  w.add_contour(c, 0.01);
+  w.set_extruder(1);
+
+  const auto data = w.get_data();
+  CHECK(w.get_extruder() == 1);
+  CHECK(count(data, "T1\n") == 1);
+  CHECK(count(data, "T0\n") == 1);
+  // each extruder uses its own settings
+  CHECK(count(data, "F3000") == 1);
+  CHECK(count(data, "F1200") == 1);
+  // extruder 1 is primed again after being idle
+  const auto back = data.rfind("T0");
+  CHECK(data.find("G1 E1.00000", back) != std::string::npos);
+}
+
+TEST_CASE("GCodeWriter state test") {
+  auto settings = sse::Settings();
+  settings.config = toml::table{
+      {"printer", toml::table{{"extruder_1", toml::table{{"retraction_distance", 1.0}}},
+                              {"extruder_2", toml::table{{"retraction_distance", 2.0}}}}}};
+  auto first = sse::Contour();
+  first.z = 0.2;
+  first.move_to(gp_XY(0, 0));
+  first.line_to(gp_XY(10, 0));
+  auto second = first;
+  second.z = 0.4;
+
+  // a layer rendered from the state before it is the same as rendered in
+  // sequence
+  auto serial = sse::GCodeWriter(settings);
+  serial.add_contour(first, 0.01);
+  serial.set_extruder(2);
+  const auto state = serial.get_state();
+  const auto begin = serial.get_data().size();
+  serial.add_contour(second, 0.01);
+  serial.set_extruder(1);
+
+  auto layer = sse::GCodeWriter(settings, state);
+  layer.add_contour(second, 0.01);
+  layer.set_extruder(1);
+  CHECK(layer.get_data() == serial.get_data().substr(begin));
+  // extruder 1 was retracted when switching to extruder 2
+  CHECK(count(layer.get_data(), "G1 E1.00000") == 1);
+}
+
+TEST_CASE("GCodeWriter chunked write test") {
+  const auto chunks = std::vector<std::string>{";layer 1\n", "", ";layer 2\n"};
+  const auto file = std::filesystem::temp_directory_path() / "sse_test_write.gcode";
+  sse::GCodeWriter::write(file, chunks);
+  auto stream = std::ifstream(file);
+  const auto data = std::string(std::istreambuf_iterator<char>(stream), {});
+  CHECK(data == ";layer 1\n;layer 2\n");
+  std::filesystem::remove(file);
+}
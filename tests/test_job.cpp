@@ -0,0 +1,140 @@
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <sse/Batch.hpp>
+#include <sse/ImportCache.hpp>
+#include <sse/Job.hpp>
+
+TEST_CASE("Job description test") {
+  SUBCASE("complete") {
+    const toml::value table = toml::table{
+        {"profile", "profile.toml"},
+        {"files", toml::array{"a.step", "b.step"}},
+        {"extruders", toml::array{1, 2}},
+        {"autoplace", true},
+        {"overrides", toml::table{{"layer_height", 0.1}}}};
+    const auto job = sse::JobDescription::from_toml(table);
+    CHECK(job.files.size() == 2);
+    CHECK(job.extruders == std::vector<int>{1, 2});
+    CHECK(job.profile == "profile.toml");
+    CHECK(job.autoplace);
+    CHECK_FALSE(job.spiral);
+    CHECK(sse::Settings::find_setting<double>(job.overrides, "layer_height") ==
+          doctest::Approx(0.1));
+  }
+
+  SUBCASE("missing files") {
+    const toml::value table = toml::table{{"profile", "profile.toml"}};
+    CHECK_THROWS_AS(sse::JobDescription::from_toml(table), std::runtime_error);
+  }
+}
+
+TEST_CASE("Settings overrides test") {
+  auto settings = sse::Settings();
+  settings.config = toml::table{
+      {"layer_height", 0.2},
+      {"printer", toml::table{{"num_extruders", 1}, {"name", "Example"}}}};
+  settings.merge(toml::table{{"layer_height", 0.1},
+                             {"printer", toml::table{{"num_extruders", 2}}}});
+  CHECK(settings.get_setting<double>("layer_height") == doctest::Approx(0.1));
+  // nested tables are merged
+  CHECK(settings.get_setting<int>("printer.num_extruders") == 2);
+  CHECK(settings.get_setting<std::string>("printer.name") == "Example");
+  CHECK_THROWS_AS(settings.merge(toml::value(1)), std::runtime_error);
+}
+
+TEST_CASE("Batch manifest test") {
+  const toml::value manifest = toml::table{
+      {"profile", "profile.toml"},
+      {"jobs", toml::array{toml::table{{"files", toml::array{"a.step"}}, {"output", "1.gcode"}},
+                           toml::table{{"files", toml::array{"/parts/b.step"}},
+                                       {"profile", "other.toml"},
+                                       {"output", "2.gcode"}}}}};
+
+  SUBCASE("paths and defaults") {
+    const auto batch = sse::Batch::from_toml(manifest, "/plates");
+    const auto &entries = batch.get_entries();
+    REQUIRE(entries.size() == 2);
+    // relative to the manifest
+    CHECK(entries[0].description.files.front() == "/plates/a.step");
+    CHECK(entries[0].description.profile == "/plates/profile.toml");
+    CHECK(entries[0].output == "/plates/1.gcode");
+    CHECK(entries[1].description.files.front() == "/parts/b.step");
+    CHECK(entries[1].description.profile == "/plates/other.toml");
+  }
+
+  SUBCASE("missing output") {
+    const toml::value invalid =
+        toml::table{{"jobs", toml::array{toml::table{{"files", toml::array{"a.step"}},
+                                                     {"profile", "profile.toml"}}}}};
+    CHECK_THROWS_AS(sse::Batch::from_toml(invalid, "."), std::runtime_error);
+  }
+}
+
+TEST_CASE("Import cache eviction test") {
+  const auto directory = std::filesystem::temp_directory_path() / "sse_test_cache";
+  std::filesystem::create_directories(directory);
+  const auto write_profile = [&](const std::string &name, double layer_height) {
+    const auto file = directory / name;
+    auto out = std::ofstream(file);
+    out << "layer_height = " << layer_height << "\n"
+        << "[printer]\nname = \"Example\"\n"
+        << "[printer.build_plate]\nis_circle = false\n";
+    return file;
+  };
+  auto cache = sse::ImportCache(2);
+  const auto a = write_profile("a.toml", 0.1);
+  const auto b = write_profile("b.toml", 0.2);
+  const auto c = write_profile("c.toml", 0.3);
+
+  SUBCASE("least recently used") {
+    cache.settings(a);
+    cache.settings(b);
+    // a is used again, b is the oldest
+    cache.settings(a);
+    cache.settings(c);
+    CHECK(cache.size() == 2);
+    // a is still cached: new contents with the same time aren't read
+    const auto time = std::filesystem::last_write_time(a);
+    write_profile("a.toml", 0.15);
+    std::filesystem::last_write_time(a, time);
+    CHECK(cache.settings(a).get_setting<double>("layer_height") == doctest::Approx(0.1));
+  }
+
+  SUBCASE("stale versions") {
+    CHECK(cache.settings(a).get_setting<double>("layer_height") == doctest::Approx(0.1));
+    write_profile("a.toml", 0.15);
+    std::filesystem::last_write_time(
+        a, std::filesystem::last_write_time(a) + std::chrono::seconds(1));
+    // the edited profile replaces the previous one
+    CHECK(cache.settings(a).get_setting<double>("layer_height") == doctest::Approx(0.15));
+    CHECK(cache.size() == 1);
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Job missing file test") {
+  const auto directory = std::filesystem::temp_directory_path() / "sse_test_job";
+  std::filesystem::create_directories(directory);
+  const auto profile = directory / "profile.toml";
+  {
+    auto out = std::ofstream(profile);
+    out << "[printer]\nname = \"Example\"\n[printer.build_plate]\nis_circle = false\n";
+  }
+  auto description = sse::JobDescription();
+  description.profile = profile;
+  description.files = {(directory / "missing.step").string()};
+  auto cache = sse::ImportCache();
+  auto job = sse::Job(description, cache, spdlog::default_logger());
+  // the job fails, naming the file, instead of slicing a partial plate
+  try {
+    job.run();
+    FAIL("a job with a missing file succeeded");
+  } catch (const std::runtime_error &e) {
+    CHECK(std::string(e.what()).find("missing.step") != std::string::npos);
+  }
+  std::filesystem::remove_all(directory);
+}
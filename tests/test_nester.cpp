@@ -0,0 +1,139 @@
+#include <doctest/doctest.h>
+
+#include <sse/Nester.hpp>
+#include <sse/Packer.hpp>
+
+#include <BRepAlgoAPI_Common.hxx>
+#include <BRepAlgoAPI_Fuse.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+
+#include <memory>
+
+TEST_CASE("Nester parameter sanitization") {
+  // create empty vector
+  auto objects = std::vector<std::shared_ptr<sse::Object>>();
+
+  SUBCASE("testing nester without objects") {
+    CHECK_THROWS_AS(auto n = sse::Nester(objects, 100, 100), std::runtime_error);
+  }
+
+  SUBCASE("testing nester with empty object") {
+    auto a = TopoDS_Shape();
+    objects.push_back(std::make_shared<sse::Object>(a));
+    CHECK_THROWS_AS(auto n = sse::Nester(objects, 100, 100), std::runtime_error);
+  }
+
+  SUBCASE("testing nester with object bigger than the plate") {
+    auto box = BRepPrimAPI_MakeBox(150, 10, 10).Shape();
+    objects.push_back(std::make_shared<sse::Object>(box));
+    auto n = sse::Nester(objects, 100, 100);
+    CHECK_THROWS_AS(n.nest(), std::runtime_error);
+  }
+}
+
+TEST_CASE("Nester L-shapes test") {
+  auto objects = std::vector<std::shared_ptr<sse::Object>>();
+  // L-shape, 40x40, with 10 wide arms
+  auto l = BRepAlgoAPI_Fuse(BRepPrimAPI_MakeBox(40, 10, 10).Shape(),
+                            BRepPrimAPI_MakeBox(10, 40, 10).Shape())
+               .Shape();
+  for (auto i = 0; i < 4; ++i) {
+    objects.push_back(std::make_shared<sse::Object>(l));
+  }
+
+  const double plate = 100;
+  auto n = sse::Nester(objects, plate, plate, 2.0);
+  REQUIRE_NOTHROW(n.nest());
+  n.arrange();
+
+  // every object is on the plate
+  for (auto &o : objects) {
+    Bnd_Box b;
+    BRepBndLib::Add(o->get_shape(), b);
+    CHECK(b.CornerMin().X() >= -1e-3);
+    CHECK(b.CornerMin().Y() >= -1e-3);
+    CHECK(b.CornerMax().X() <= plate + 1e-3);
+    CHECK(b.CornerMax().Y() <= plate + 1e-3);
+  }
+
+  // objects don't overlap
+  for (std::size_t i = 0; i < objects.size(); ++i) {
+    for (std::size_t j = i + 1; j < objects.size(); ++j) {
+      CAPTURE(i);
+      CAPTURE(j);
+      auto common = BRepAlgoAPI_Common(objects[i]->get_shape(), objects[j]->get_shape()).Shape();
+      GProp_GProps props;
+      BRepGProp::VolumeProperties(common, props);
+      CHECK(props.Mass() == doctest::Approx(0.0));
+    }
+  }
+}
+
+TEST_CASE("Nester interlocking test") {
+  // L-shape, 40x40, with 10 wide arms
+  auto l = BRepAlgoAPI_Fuse(BRepPrimAPI_MakeBox(40, 10, 10).Shape(),
+                            BRepPrimAPI_MakeBox(10, 40, 10).Shape())
+               .Shape();
+  // two bounding boxes side by side need 82x40, the outlines interlock in 52x52
+  const double plate = 60;
+
+  SUBCASE("bounding boxes don't fit") {
+    auto objects = std::vector<std::shared_ptr<sse::Object>>();
+    for (auto i = 0; i < 2; ++i) {
+      objects.push_back(std::make_shared<sse::Object>(l));
+    }
+    auto p = sse::Packer(objects);
+    const auto [width, length] = p.pack();
+    CHECK(std::max(width, length) > plate);
+  }
+
+  SUBCASE("outlines fit") {
+    auto objects = std::vector<std::shared_ptr<sse::Object>>();
+    for (auto i = 0; i < 2; ++i) {
+      objects.push_back(std::make_shared<sse::Object>(l));
+    }
+    auto n = sse::Nester(objects, plate, plate, 2.0);
+    REQUIRE_NOTHROW(n.nest());
+    n.arrange();
+    auto common = BRepAlgoAPI_Common(objects[0]->get_shape(), objects[1]->get_shape()).Shape();
+    GProp_GProps props;
+    BRepGProp::VolumeProperties(common, props);
+    CHECK(props.Mass() == doctest::Approx(0.0));
+    for (auto &o : objects) {
+      Bnd_Box b;
+      BRepBndLib::Add(o->get_shape(), b);
+      CHECK(b.CornerMax().X() <= plate + 1e-3);
+      CHECK(b.CornerMax().Y() <= plate + 1e-3);
+    }
+  }
+}
+
+TEST_CASE("Nester circular build plate test") {
+  auto objects = std::vector<std::shared_ptr<sse::Object>>();
+  // the diagonal of this box is longer than the plate diameter
+  auto box = BRepPrimAPI_MakeBox(70, 70, 10).Shape();
+  objects.push_back(std::make_shared<sse::Object>(box));
+
+  SUBCASE("rectangular plate") {
+    auto n = sse::Nester(objects, 100, 100, 2.0);
+    CHECK_NOTHROW(n.nest());
+  }
+
+  SUBCASE("circular plate") {
+    auto n = sse::Nester(objects, 100, 100, 2.0, 1.0, true);
+    CHECK_THROWS_AS(n.nest(), std::runtime_error);
+  }
+
+  SUBCASE("circular plate, placed at the center") {
+    auto small = BRepPrimAPI_MakeBox(20, 20, 10).Shape();
+    objects.front() = std::make_shared<sse::Object>(small);
+    auto n = sse::Nester(objects, 100, 100, 2.0, 1.0, true);
+    REQUIRE_NOTHROW(n.nest());
+    n.arrange();
+    Bnd_Box b;
+    BRepBndLib::Add(objects.front()->get_shape(), b);
+    auto center = (b.CornerMin().XYZ() + b.CornerMax().XYZ()) / 2;
+    CHECK(center.X() == doctest::Approx(50).epsilon(0.05));
+    CHECK(center.Y() == doctest::Approx(50).epsilon(0.05));
+  }
+}
@@ -0,0 +1,71 @@
+#include <doctest/doctest.h>
+
+#include <sse/Object.hpp>
+
+#include <BRepPrimAPI_MakeBox.hxx>
+
+TEST_CASE("Object transform test") {
+  // make a box with one corner at origin, with X,Y,Z dimensions of 10,20,30
+  auto box = BRepPrimAPI_MakeBox(10, 20, 30).Shape();
+  auto o = sse::Object(box);
+  // measure the shape itself, without the object's gap
+  auto bounds = [&]() {
+    Bnd_Box b;
+    BRepBndLib::Add(o.get_shape(), b);
+    return b;
+  };
+
+  SUBCASE("translation") {
+    o.translate(5, 5, 5);
+    o.translate(-10, 0, 0);
+    // bounding box is updated without touching the shape
+    CHECK(o.width() == doctest::Approx(10 + 2 * 5));
+    auto b = bounds();
+    CHECK(b.CornerMin().X() == doctest::Approx(-5).epsilon(0.01));
+    CHECK(b.CornerMin().Y() == doctest::Approx(5).epsilon(0.01));
+    CHECK(b.CornerMin().Z() == doctest::Approx(5).epsilon(0.01));
+  }
+
+  SUBCASE("quarter turn") {
+    o.rotate(gp::OZ(), 90);
+    // width and length are swapped
+    CHECK(o.width() == doctest::Approx(20 + 2 * 5));
+    CHECK(o.length() == doctest::Approx(10 + 2 * 5));
+    auto b = bounds();
+    CHECK(b.CornerMax().X() - b.CornerMin().X() == doctest::Approx(20).epsilon(0.01));
+  }
+
+  SUBCASE("volume") {
+    o.rotateX(33);
+    o.mirrorYZ();
+    CHECK(o.get_volume() == doctest::Approx(10 * 20 * 30));
+  }
+
+  SUBCASE("cached properties follow transformations") {
+    CHECK(o.center_of_mass().X() == doctest::Approx(5));
+    o.translate(10, 0, 0);
+    o.rotate(gp_Ax1(o.center_point(), gp::DZ()), 90);
+    // computed in closed form
+    CHECK(o.center_of_mass().X() == doctest::Approx(15));
+    CHECK(o.get_volume() == doctest::Approx(10 * 20 * 30));
+    // quarter turns keep the cached bounds exact, without recomputing them
+    const auto &cached = o.get_bound_box();
+    const double gap = cached.GetGap();
+    auto exact = bounds();
+    CHECK(cached.CornerMin().X() + gap == doctest::Approx(exact.CornerMin().X()).epsilon(0.01));
+    CHECK(cached.CornerMin().Y() + gap == doctest::Approx(exact.CornerMin().Y()).epsilon(0.01));
+    CHECK(cached.CornerMax().X() - gap == doctest::Approx(exact.CornerMax().X()).epsilon(0.01));
+    CHECK(cached.CornerMax().Y() - gap == doctest::Approx(exact.CornerMax().Y()).epsilon(0.01));
+    CHECK(o.width() == doctest::Approx(20 + 2 * gap));
+    CHECK(o.length() == doctest::Approx(10 + 2 * gap));
+  }
+
+  SUBCASE("replacing the shape invalidates the cache") {
+    CHECK(o.get_volume() == doctest::Approx(10 * 20 * 30));
+    auto version = o.get_version();
+    auto cube = BRepPrimAPI_MakeBox(10, 10, 10).Shape();
+    o.set_shape(cube);
+    CHECK(o.get_version() != version);
+    CHECK(o.get_volume() == doctest::Approx(1000));
+  }
+}
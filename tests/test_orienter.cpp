@@ -0,0 +1,53 @@
+#include <doctest/doctest.h>
+
+#include <sse/Orienter.hpp>
+
+#include <BRepBndLib.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+
+TEST_CASE("Orienter parameter sanitization") {
+  auto box = BRepPrimAPI_MakeBox(10, 10, 10).Shape();
+  auto o = sse::Object(box);
+  CHECK_THROWS_AS(auto r = sse::Orienter(o, 0.0), std::runtime_error);
+}
+
+TEST_CASE("Orienter box test") {
+  // a tall box prints fastest lying on its biggest side
+  auto box = BRepPrimAPI_MakeBox(10, 20, 50).Shape();
+  auto o = sse::Object(box);
+  auto r = sse::Orienter(o, 0.4);
+
+  auto scored = r.evaluate();
+  // one candidate per side
+  REQUIRE(scored.size() == 6);
+  // best first
+  for (std::size_t i = 1; i < scored.size(); ++i) {
+    CHECK(scored[i - 1].cost <= scored[i].cost);
+  }
+  // a box never needs support
+  for (const auto &c : scored) {
+    CHECK(c.overhang_area == doctest::Approx(0.0));
+    CHECK(c.contact_area > 0);
+  }
+
+  auto best = r.orient();
+  CHECK(best.height == doctest::Approx(10.0));
+  CHECK(best.layers == 25);
+  CHECK(best.contact_area == doctest::Approx(1000.0));
+
+  // the object now lies flat on the build plate
+  Bnd_Box b;
+  BRepBndLib::Add(o.get_shape(), b);
+  CHECK(b.CornerMin().Z() == doctest::Approx(0.0).epsilon(1e-3));
+  CHECK(b.CornerMax().Z() - b.CornerMin().Z() == doctest::Approx(10.0).epsilon(1e-3));
+}
+
+TEST_CASE("Orienter weights test") {
+  // rewarding height stands the box upright
+  auto box = BRepPrimAPI_MakeBox(10, 20, 50).Shape();
+  auto o = sse::Object(box);
+  auto weights = sse::Orienter::Weights();
+  weights.height = -1.0;
+  auto r = sse::Orienter(o, 0.4, 45.0, weights);
+  CHECK(r.orient().height == doctest::Approx(50.0));
+}
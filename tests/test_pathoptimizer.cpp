@@ -0,0 +1,111 @@
+#include <doctest/doctest.h>
+
+#include <sse/PathOptimizer.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+sse::Contour square(double x, double y) {
+  auto c = sse::Contour();
+  c.move_to(gp_XY(x, y));
+  c.line_to(gp_XY(x + 1, y));
+  c.line_to(gp_XY(x + 1, y + 1));
+  c.line_to(gp_XY(x, y + 1));
+  c.line_to(gp_XY(x, y));
+  return c;
+}
+
+} // namespace
+
+TEST_CASE("PathOptimizer test") {
+  SUBCASE("grid of islands") {
+    auto contours = std::vector<sse::Contour>();
+    for (int i = 0; i < 10; ++i) {
+      for (int j = 0; j < 10; ++j) {
+        contours.push_back(square(i * 5, j * 5));
+      }
+    }
+    std::shuffle(contours.begin(), contours.end(), std::mt19937(1));
+    const double before = sse::PathOptimizer::travel(contours, gp_XY(0, 0));
+    sse::PathOptimizer().optimize(contours);
+    CHECK(contours.size() == 100);
+    // at least one step between neighbours per island, at most a few more
+    const double after = sse::PathOptimizer::travel(contours, gp_XY(0, 0));
+    CHECK(after < before / 2);
+    CHECK(after < 100 * 5 * 1.5);
+    for (const auto &c : contours) {
+      CHECK(c.closed());
+    }
+  }
+
+  SUBCASE("loop start") {
+    auto contours = std::vector<sse::Contour>{square(10, 10)};
+    sse::PathOptimizer(gp_XY(20, 20)).optimize(contours);
+    // the loop starts on the corner closest to the tool
+    CHECK(contours.front().points.front().IsEqual(gp_XY(11, 11), Precision::Confusion()));
+    CHECK(contours.front().closed());
+    CHECK(contours.front().length() == doctest::Approx(4.0));
+  }
+
+  SUBCASE("open path") {
+    auto line = sse::Contour();
+    line.move_to(gp_XY(100, 0));
+    line.line_to(gp_XY(50, 0));
+    auto contours = std::vector<sse::Contour>{line};
+    const auto end = sse::PathOptimizer().optimize(contours);
+    // printed backwards, from its end closest to the origin
+    CHECK(contours.front().points.front().IsEqual(gp_XY(50, 0), Precision::Confusion()));
+    CHECK(end.IsEqual(gp_XY(100, 0), Precision::Confusion()));
+  }
+
+  SUBCASE("order") {
+    auto contours = std::vector<sse::Contour>();
+    for (int i = 0; i < 10; ++i) {
+      contours.push_back(square(i * 5, (i % 3) * 5));
+    }
+    std::shuffle(contours.begin(), contours.end(), std::mt19937(1));
+    const auto original = contours;
+    auto order = std::vector<std::size_t>();
+    sse::PathOptimizer().optimize(contours, &order);
+    REQUIRE(order.size() == original.size());
+    auto sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+      CHECK(sorted[i] == i);
+    }
+    // every contour comes from the one at its former index
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      const auto &corner = original[order[i]].points.front();
+      const auto &points = contours[i].points;
+      CHECK(std::any_of(points.begin(), points.end(), [&](const auto &p) {
+        return p.IsEqual(corner, Precision::Confusion());
+      }));
+    }
+  }
+
+  SUBCASE("connect") {
+    // sequenced from a guess, then joined to the actual position of the tool
+    auto contours = std::vector<sse::Contour>();
+    for (int i = 0; i < 10; ++i) {
+      contours.push_back(square(i * 5, 0));
+    }
+    auto order = std::vector<std::size_t>();
+    sse::PathOptimizer(gp_XY(0, 0)).sequence(contours, &order);
+    REQUIRE(order.front() == 0);
+    sse::PathOptimizer::connect(contours, gp_XY(60, 0), &order);
+    // printed from the other end of the row, the closest to the tool
+    CHECK(order.front() == 9);
+    CHECK(order.back() == 0);
+    CHECK(contours.front().points.front().IsEqual(gp_XY(46, 0), Precision::Confusion()));
+    CHECK(sse::PathOptimizer::travel(contours, gp_XY(60, 0)) < 60);
+  }
+
+  SUBCASE("empty layer") {
+    auto contours = std::vector<sse::Contour>();
+    const auto end = sse::PathOptimizer(gp_XY(1, 2)).optimize(contours);
+    CHECK(contours.empty());
+    CHECK(end.IsEqual(gp_XY(1, 2), Precision::Confusion()));
+  }
+}
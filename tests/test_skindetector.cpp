@@ -0,0 +1,70 @@
+#include <doctest/doctest.h>
+
+#include <sse/SkinDetector.hpp>
+
+namespace {
+
+sse::Contour square(double x, double y, double size, double z) {
+  auto c = sse::Contour();
+  c.z = z;
+  c.move_to(gp_XY(x, y));
+  c.line_to(gp_XY(x + size, y));
+  c.line_to(gp_XY(x + size, y + size));
+  c.line_to(gp_XY(x, y + size));
+  c.line_to(gp_XY(x, y));
+  return c;
+}
+
+double area(const std::vector<sse::Contour> &contours) {
+  double result = 0;
+  for (const auto &c : contours) {
+    for (std::size_t i = 0; i + 1 < c.points.size(); ++i) {
+      result += c.points[i].Crossed(c.points[i + 1]) / 2;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("SkinDetector test") {
+  // 10x10 block, with a 5x5 block on top of it from layer 5
+  auto layers = std::vector<std::vector<sse::Contour>>();
+  for (int i = 0; i < 10; ++i) {
+    layers.push_back({i < 5 ? square(0, 0, 10, i * 0.2) : square(0, 0, 5, i * 0.2)});
+  }
+  // hole in layer 1
+  layers[1].push_back(square(2, 2, 1, 0.2));
+
+  const auto skins = sse::SkinDetector(2, 2, 0.01).detect(layers);
+  REQUIRE(skins.size() == 10);
+  // bottom layers
+  CHECK(area(skins[0]) == doctest::Approx(100));
+  CHECK(area(skins[1]) == doctest::Approx(99));
+  // above the hole
+  CHECK(area(skins[2]) == doctest::Approx(1));
+  // below the step, and above the hole
+  CHECK(area(skins[3]) == doctest::Approx(76));
+  CHECK(area(skins[4]) == doctest::Approx(75));
+  // sparse
+  CHECK(skins[5].empty());
+  CHECK(skins[6].empty());
+  CHECK(skins[7].empty());
+  // top layers
+  CHECK(area(skins[8]) == doctest::Approx(25));
+  CHECK(skins[9].front().z == doctest::Approx(1.8));
+
+  SUBCASE("minimum width") {
+    // the skin above the 1 mm hole is too narrow
+    const auto wide = sse::SkinDetector(2, 2, 0.01, 1.5).detect(layers);
+    CHECK(wide[2].empty());
+    CHECK(area(wide[4]) == doctest::Approx(75));
+  }
+}
+
+TEST_CASE("SkinDetector intersection test") {
+  const auto result = sse::SkinDetector::intersection({square(0, 0, 10, 1)},
+                                                      {square(5, 5, 10, 1)}, 0.01);
+  CHECK(area(result) == doctest::Approx(25));
+  CHECK(result.front().z == doctest::Approx(1));
+}
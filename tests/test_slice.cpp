@@ -0,0 +1,81 @@
+#include <doctest/doctest.h>
+
+#include <sse/Slice.hpp>
+
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <gp_Pln.hxx>
+
+#include <algorithm>
+#include <cmath>
+
+TEST_CASE("Slice from layer faces test") {
+  auto faces = TopTools_ListOfShape();
+  faces.Append(BRepBuilderAPI_MakeFace(gp_Pln(gp_Pnt(0, 0, 5), gp::DZ()), 0, 10, 0, 20).Face());
+  faces.Append(BRepBuilderAPI_MakeFace(gp_Pln(gp_Pnt(0, 0, 5), gp::DZ()), 30, 40, 0, 20).Face());
+
+  auto s = sse::Slice(faces);
+  CHECK(s.get_faces().Length() == 2);
+  CHECK(s.get_bound_box().CornerMin().Z() == doctest::Approx(5.0).epsilon(1e-3));
+
+  // slices are ordered by height
+  auto above = TopTools_ListOfShape();
+  above.Append(BRepBuilderAPI_MakeFace(gp_Pln(gp_Pnt(0, 0, 6), gp::DZ()), 0, 10, 0, 20).Face());
+  CHECK(s < sse::Slice(above));
+
+  // a thick slab is printed after the thin slabs below its top
+  auto thin = sse::Slice(above);
+  auto settings = thin.get_settings();
+  settings.layer_height = 0.1;
+  thin.set_settings(settings);
+  settings.layer_height = 1.5;
+  s.set_settings(settings);
+  CHECK(thin.print_height() == doctest::Approx(6.1).epsilon(1e-3));
+  CHECK(s.print_height() == doctest::Approx(6.5).epsilon(1e-3));
+  CHECK(thin < s);
+}
+
+TEST_CASE("Slice shells test") {
+  auto faces = TopTools_ListOfShape();
+  faces.Append(BRepBuilderAPI_MakeFace(gp_Pln(gp_Pnt(0, 0, 5), gp::DZ()), 0, 10, 0, 20).Face());
+  faces.Append(BRepBuilderAPI_MakeFace(gp_Pln(gp_Pnt(0, 0, 5), gp::DZ()), 30, 40, 0, 20).Face());
+  auto s = sse::Slice(faces);
+
+  SUBCASE("every shell of every face") {
+    s.generate_shells(3, 0.4);
+    CHECK(s.get_shells().Extent() == 6);
+    s.generate_contours(0.01);
+    // only the shells are printed
+    CHECK(s.get_contours().size() == 6);
+    CHECK(s.get_outlines().size() == 2);
+    for (const auto &c : s.get_contours()) {
+      CHECK(c.closed());
+      // printed on top of the slab
+      CHECK(c.z == doctest::Approx(5.0 + s.get_settings().layer_height).epsilon(1e-3));
+    }
+    // the first shell is half a width inside the 10x20 outline
+    const auto &contours = s.get_contours();
+    CHECK(std::any_of(contours.begin(), contours.end(), [](const auto &c) {
+      return std::abs(c.length() - 2 * (9.6 + 19.6)) < 1e-3;
+    }));
+    CHECK(std::none_of(contours.begin(), contours.end(), [](const auto &c) {
+      return std::abs(c.length() - 2 * (10.0 + 20.0)) < 1e-3;
+    }));
+  }
+
+  SUBCASE("settings of each face") {
+    auto region = s.get_settings();
+    region.shells = 1;
+    s.set_face_settings(2, region);
+    CHECK(s.get_face_settings(1).shells == 3);
+    CHECK(s.get_face_settings(2).shells == 1);
+    s.generate_shells();
+    CHECK(s.get_shells().Extent() == 4);
+  }
+
+  SUBCASE("too thin") {
+    // a 10 mm wide face fits at most 12 shells of 0.4 mm per face
+    s.generate_shells(20, 0.4);
+    CHECK(s.get_shells().Extent() < 40);
+    CHECK(s.get_shells().Extent() >= 24);
+  }
+}
@@ -0,0 +1,306 @@
+#include <doctest/doctest.h>
+
+#include <sse/slicer.hpp>
+
+#include <spdlog/sinks/null_sink.h>
+
+#include <BRepAlgoAPI_Cut.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepGProp.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRepPrimAPI_MakeCylinder.hxx>
+#include <GProp_GProps.hxx>
+#include <gp_Ax2.hxx>
+
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief 20x20x5 plate with a hole of radius 3 through its center
+ */
+TopoDS_Shape plate_with_hole() {
+  const auto box = BRepPrimAPI_MakeBox(20, 20, 5).Shape();
+  const auto hole =
+      BRepPrimAPI_MakeCylinder(gp_Ax2(gp_Pnt(10, 10, -1), gp::DZ()), 3, 7).Shape();
+  return BRepAlgoAPI_Cut(box, hole).Shape();
+}
+
+/**
+ * @brief Slab of one 10x10 face, of height 1, printed by an extruder
+ */
+std::unique_ptr<sse::Slice> square_slice(double x, double z, int extruder) {
+  auto faces = TopTools_ListOfShape();
+  faces.Append(
+      BRepBuilderAPI_MakeFace(gp_Pln(gp_Pnt(0, 0, z), gp::DZ()), x, x + 10, 0, 10).Face());
+  auto s = std::make_unique<sse::Slice>(faces);
+  auto settings = sse::CompiledSettings();
+  settings.layer_height = 1;
+  settings.shells = 2;
+  s->set_settings(settings);
+  s->set_extruder(extruder);
+  s->generate_shells();
+  s->generate_contours(settings.tolerance);
+  return s;
+}
+
+double area(const TopoDS_Shape &face) {
+  auto properties = GProp_GProps();
+  BRepGProp::SurfaceProperties(face, properties);
+  return properties.Mass();
+}
+
+} // namespace
+
+TEST_CASE("Extruder scheduling test") {
+  SUBCASE("single extruder") {
+    const auto schedule = sse::Slicer::schedule_extruders({{1, 1}, {1}}, 1);
+    CHECK(schedule == std::vector<std::vector<int>>{{1}, {1}});
+  }
+
+  SUBCASE("one change per layer") {
+    // each layer starts with the extruder the previous one ended with
+    const auto schedule = sse::Slicer::schedule_extruders({{1, 2}, {2, 1}, {1}, {2}}, 1);
+    CHECK(schedule == std::vector<std::vector<int>>{{1, 2}, {2, 1}, {1}, {2}});
+  }
+
+  SUBCASE("end with the next layer's extruder") {
+    const auto schedule = sse::Slicer::schedule_extruders({{1, 2, 3}, {3}}, 2);
+    CHECK(schedule.front().front() == 2);
+    CHECK(schedule.front().back() == 3);
+    CHECK(schedule.front().size() == 3);
+  }
+}
+
+TEST_CASE("Slicer concurrent jobs test") {
+  // every job has its own settings and logger
+  const auto logger = std::make_shared<spdlog::logger>(
+      "test", std::make_shared<spdlog::sinks::null_sink_mt>());
+  auto fine = sse::Settings();
+  fine.config = toml::table{{"layer_height", 0.1}};
+  auto coarse = sse::Settings();
+  coarse.config = toml::table{{"layer_height", 0.3}};
+  auto a = sse::Slicer(fine, logger);
+  auto b = sse::Slicer(coarse, logger);
+  CHECK(a.get_settings().get_setting<double>("layer_height") == doctest::Approx(0.1));
+  CHECK(b.get_settings().get_setting<double>("layer_height") == doctest::Approx(0.3));
+
+  // each job slices its own copy of a part, on its own thread
+  const auto box = BRepPrimAPI_MakeBox(10, 10, 3).Shape();
+  const auto run = [&](sse::Slicer &slicer) {
+    const auto slices = slicer.slice({std::make_shared<sse::Object>(box)});
+    auto gcode = slicer.generate_gcode(slices);
+    // the header has the time of day
+    gcode.erase(gcode.begin());
+    return std::make_pair(slices.size(), gcode);
+  };
+  const auto serial_a = run(a);
+  const auto serial_b = run(b);
+  auto concurrent_a = decltype(serial_a)();
+  auto concurrent_b = decltype(serial_b)();
+  auto ta = std::thread([&]() { concurrent_a = run(a); });
+  auto tb = std::thread([&]() { concurrent_b = run(b); });
+  ta.join();
+  tb.join();
+  // the same results as alone, with the layers of each job's settings
+  CHECK(serial_a.first > serial_b.first);
+  CHECK(concurrent_a.first == serial_a.first);
+  CHECK(concurrent_b.first == serial_b.first);
+  CHECK(concurrent_a.second == serial_a.second);
+  CHECK(concurrent_b.second == serial_b.second);
+}
+
+TEST_CASE("Slicer G-code header test") {
+  // E values are relative: the program must say so, firmware often defaults
+  // to absolute extrusion
+  const auto logger = std::make_shared<spdlog::logger>(
+      "test", std::make_shared<spdlog::sinks::null_sink_mt>());
+  auto s = sse::Slicer(sse::Settings(), logger);
+
+  SUBCASE("slices") {
+    const auto chunks = s.generate_gcode({});
+    REQUIRE(chunks.size() == 1);
+    CHECK(chunks.front().find("M83\n") != std::string::npos);
+  }
+
+  SUBCASE("toolpaths") {
+    const auto gcode = s.generate_toolpaths({});
+    CHECK(gcode.find("M83\n") != std::string::npos);
+    // every other line of the header is a comment
+    auto stream = std::istringstream(gcode);
+    for (std::string line; std::getline(stream, line);) {
+      CAPTURE(line);
+      CHECK((line.rfind(";", 0) == 0 || line == "G21" || line == "G90" || line == "M83"));
+    }
+  }
+}
+
+TEST_CASE("Slicer section test") {
+  const auto logger = std::make_shared<spdlog::logger>(
+      "test", std::make_shared<spdlog::sinks::null_sink_mt>());
+  const auto slice = [&](const std::string &mode) {
+    auto settings = sse::Settings();
+    settings.config = toml::table{{"layer_height", 1.0}, {"slicing_mode", mode}};
+    auto slicer = sse::Slicer(settings, logger);
+    auto shape = plate_with_hole();
+    return slicer.slice({std::make_shared<sse::Object>(shape)});
+  };
+  const auto split = slice("split");
+  const auto section = slice("section");
+
+  // the same layers, from the same planes
+  REQUIRE(!split.empty());
+  REQUIRE(section.size() == split.size());
+  for (std::size_t i = 0; i < split.size(); ++i) {
+    CAPTURE(i);
+    CHECK(section[i]->print_height() == doctest::Approx(split[i]->print_height()));
+    // the filled hole is dropped: one face, with a hole, per layer
+    REQUIRE(section[i]->get_faces().Length() == 1);
+    REQUIRE(split[i]->get_faces().Length() == 1);
+    const double expected = 20 * 20 - M_PI * 3 * 3;
+    CHECK(area(section[i]->get_faces().Value(1)) == doctest::Approx(expected).epsilon(1e-3));
+    CHECK(area(split[i]->get_faces().Value(1)) == doctest::Approx(expected).epsilon(1e-3));
+    // the hole has its own outline, printed around
+    CHECK(section[i]->get_outlines().size() == split[i]->get_outlines().size());
+  }
+}
+
+TEST_CASE("Slicer modifier settings test") {
+  const auto logger = std::make_shared<spdlog::logger>(
+      "test", std::make_shared<spdlog::sinks::null_sink_mt>());
+  auto settings = sse::Settings();
+  const auto modifier = [](const char *key, const toml::value &value) {
+    return toml::table{
+        {"objects",
+         toml::table{{"part", toml::table{{"modifiers",
+                                            toml::array{toml::table{{"file", "boss.step"},
+                                                                    {key, value}}}}}}}}};
+  };
+  auto cache = sse::ImportCache();
+  const auto box = BRepPrimAPI_MakeBox(10, 10, 10).Shape();
+  auto object = sse::Object(box, "part.step");
+
+  // a layer height can't change inside a layer: rejected before importing
+  settings.config = modifier("layer_height", 0.1);
+  try {
+    sse::Slicer(settings, logger).load_object_settings(object, cache);
+    FAIL("a modifier layer height was accepted");
+  } catch (const std::runtime_error &e) {
+    CHECK(std::string(e.what()).find("layer_height") != std::string::npos);
+  }
+
+  // supported settings get as far as importing the (missing) volume
+  settings.config = modifier("shells", 4);
+  try {
+    sse::Slicer(settings, logger).load_object_settings(object, cache);
+    FAIL("a missing modifier was imported");
+  } catch (const std::runtime_error &e) {
+    CHECK(std::string(e.what()).find("boss.step") != std::string::npos);
+  }
+}
+
+TEST_CASE("Slicer G-code layers test") {
+  const auto logger = std::make_shared<spdlog::logger>(
+      "test", std::make_shared<spdlog::sinks::null_sink_mt>());
+  auto settings = sse::Settings();
+  settings.config = toml::table{
+      {"printer", toml::table{{"num_extruders", 2}}},
+      {"prime_tower", true},
+      {"prime_tower_x", 50},
+      {"prime_tower_y", 0},
+      {"prime_tower_size", 2},
+      {"combing", false}};
+  auto s = sse::Slicer(settings, logger);
+  // two layers of two objects: the first one by T0 at X 0..10, the second
+  // one by T1 at X 20..30
+  auto slices = std::vector<std::unique_ptr<sse::Slice>>();
+  slices.push_back(square_slice(0, 0, 1));
+  slices.push_back(square_slice(20, 0, 2));
+  slices.push_back(square_slice(0, 1, 1));
+  slices.push_back(square_slice(20, 1, 2));
+
+  const auto chunks = s.generate_gcode(slices);
+  // the header, then the layers in order
+  REQUIRE(chunks.size() == 3);
+  CHECK(chunks[0].find("M83\n") != std::string::npos);
+  CHECK(chunks[1].rfind(";layer z=1.000\n", 0) == 0);
+  CHECK(chunks[2].rfind(";layer z=2.000\n", 0) == 0);
+  for (std::size_t l = 1; l < chunks.size(); ++l) {
+    CAPTURE(l);
+    // every layer resets E on its own
+    CHECK(chunks[l].find("G92 E0\n") != std::string::npos);
+  }
+  // one tool change per layer: the second layer starts with the extruder the
+  // first one ends with, which its writer gets from the planned start state
+  CHECK(chunks[1].find("T1\n") != std::string::npos);
+  CHECK(chunks[1].find("T0\n") == std::string::npos);
+  CHECK(chunks[2].find("T0\n") != std::string::npos);
+  CHECK(chunks[2].find("T1\n") == std::string::npos);
+  // the tower purges the extruder switched to, right after the change
+  CHECK(chunks[1].find("T1\n") < chunks[1].find(";prime tower"));
+  CHECK(chunks[2].find("T0\n") < chunks[2].find(";prime tower"));
+
+  // every extrusion is made by the extruder of its object, or on the tower
+  const auto program = std::accumulate(chunks.begin(), chunks.end(), std::string());
+  auto stream = std::istringstream(program);
+  int tool = 0;
+  int tower = 0;
+  int count[2] = {0, 0};
+  for (std::string line; std::getline(stream, line);) {
+    CAPTURE(line);
+    if (line.size() == 2 && line[0] == 'T') {
+      tool = line[1] - '0';
+    }
+    double x = 0;
+    if (std::sscanf(line.c_str(), "G1 X%lf", &x) != 1) {
+      continue;
+    }
+    if (x >= 50) {
+      ++tower;
+      continue;
+    }
+    const double low = tool == 0 ? 0 : 20;
+    CHECK(x >= low - 1e-3);
+    CHECK(x <= low + 10 + 1e-3);
+    ++count[tool];
+  }
+  CHECK(tower > 0);
+  CHECK(count[0] > 0);
+  CHECK(count[1] > 0);
+}
+
+TEST_CASE("Slicer merge test") {
+  const auto logger = std::make_shared<spdlog::logger>(
+      "test", std::make_shared<spdlog::sinks::null_sink_mt>());
+  auto settings = sse::Settings();
+  settings.config = toml::table{{"layer_height", 1.0}};
+  auto s = sse::Slicer(settings, logger);
+  // each object is sliced on its own: one from Z 0 to 3, one from Z 5 to 7
+  const auto low = BRepPrimAPI_MakeBox(10, 10, 3).Shape();
+  const auto high = BRepPrimAPI_MakeBox(gp_Pnt(20, 0, 5), 10, 10, 2).Shape();
+  const auto slices =
+      s.slice({std::make_shared<sse::Object>(high), std::make_shared<sse::Object>(low)});
+  REQUIRE(!slices.empty());
+  // merged by print height, whatever the order of the objects
+  for (std::size_t i = 1; i < slices.size(); ++i) {
+    CHECK(slices[i - 1]->print_height() <= slices[i]->print_height() + 1e-6);
+  }
+  // all the layers of the lower object come first
+  std::size_t lows = 0;
+  for (const auto &slice : slices) {
+    lows += slice->get_bound_box().CornerMin().X() < 15 ? 1 : 0;
+  }
+  CHECK(lows > 0);
+  CHECK(lows < slices.size());
+  for (std::size_t i = 0; i < slices.size(); ++i) {
+    CAPTURE(i);
+    CHECK((slices[i]->get_bound_box().CornerMin().X() < 15) == (i < lows));
+  }
+  CHECK(slices.front()->print_height() == doctest::Approx(1.0).epsilon(1e-3));
+  CHECK(slices.back()->print_height() == doctest::Approx(7.0).epsilon(1e-3));
+}
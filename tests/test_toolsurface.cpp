@@ -0,0 +1,56 @@
+#include <doctest/doctest.h>
+
+#include <sse/ToolSurface.hpp>
+
+#include <BRepAlgoAPI_Section.hxx>
+#include <BRepBndLib.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <TopExp_Explorer.hxx>
+
+TEST_CASE("ToolSurface parameter sanitization") {
+  Bnd_Box b;
+  CHECK_THROWS_AS(auto t = sse::PlanarToolSurface(b, 0.2), std::runtime_error);
+  b.Update(0, 0, 0, 10, 10, 10);
+  CHECK_THROWS_AS(auto t = sse::PlanarToolSurface(b, 0.0), std::runtime_error);
+  CHECK_THROWS_AS(auto t = sse::ConicalToolSurface(b, 0.2, 90.0), std::runtime_error);
+  CHECK_THROWS_AS(auto t = sse::SphericalToolSurface(b, 0.2, 0.0), std::runtime_error);
+}
+
+TEST_CASE("ToolSurface box test") {
+  auto box = BRepPrimAPI_MakeBox(20, 20, 10).Shape();
+  Bnd_Box bounds;
+  BRepBndLib::Add(box, bounds);
+
+  // every surface in the family cuts through the sides of the box
+  auto check = [&](const sse::ToolSurface &t) {
+    REQUIRE(t.count() > 0);
+    for (std::size_t i = 1; i < t.count(); ++i) {
+      CHECK(t.height(i) > t.height(i - 1));
+    }
+    auto section = BRepAlgoAPI_Section(box, t.face(t.count() / 2));
+    CHECK(section.IsDone());
+    CHECK(TopExp_Explorer(section.Shape(), TopAbs_EDGE).More());
+  };
+
+  SUBCASE("planar") {
+    auto t = sse::PlanarToolSurface(bounds, 0.5);
+    CHECK(t.count() == 20);
+    CHECK(t.height(0) == doctest::Approx(0.5).epsilon(1e-3));
+    check(t);
+  }
+
+  SUBCASE("conical") {
+    auto t = sse::ConicalToolSurface(bounds, 0.5, 30.0);
+    // the cones start below the box, to cover its bottom corners
+    CHECK(t.count() > 20);
+    check(t);
+  }
+
+  SUBCASE("inverted conical") {
+    check(sse::ConicalToolSurface(bounds, 0.5, -30.0));
+  }
+
+  SUBCASE("spherical") {
+    check(sse::SphericalToolSurface(bounds, 0.5, 50.0));
+  }
+}
@@ -0,0 +1,87 @@
+#include <doctest/doctest.h>
+
+#include <sse/TravelPlanner.hpp>
+
+namespace {
+
+sse::Contour polygon(const std::vector<gp_XY> &points) {
+  auto c = sse::Contour();
+  c.move_to(points.front());
+  for (std::size_t i = 1; i < points.size(); ++i) {
+    c.line_to(points[i]);
+  }
+  c.line_to(points.front());
+  return c;
+}
+
+} // namespace
+
+TEST_CASE("TravelPlanner test") {
+  // U shape, with a notch from y=10 up, between x=10 and x=20
+  const auto u = polygon({{0, 0}, {30, 0}, {30, 30}, {20, 30}, {20, 10}, {10, 10},
+                          {10, 30}, {0, 30}});
+  // separate island
+  const auto island = polygon({{50, 0}, {60, 0}, {60, 10}, {50, 10}});
+  const auto planner = sse::TravelPlanner({u, island}, 0.01, 0.2);
+  auto path = std::vector<gp_XY>();
+
+  SUBCASE("inside") {
+    CHECK(planner.inside(gp_XY(5, 5)));
+    CHECK(planner.inside(gp_XY(55, 5)));
+    CHECK_FALSE(planner.inside(gp_XY(15, 20)));
+    CHECK_FALSE(planner.inside(gp_XY(40, 5)));
+  }
+
+  SUBCASE("direct") {
+    REQUIRE(planner.route(gp_XY(1, 1), gp_XY(29, 1), path));
+    CHECK(path.size() == 1);
+  }
+
+  SUBCASE("around the notch") {
+    REQUIRE(planner.route(gp_XY(5, 25), gp_XY(25, 25), path));
+    // around both inner corners of the notch
+    CHECK(path.size() == 3);
+    for (const auto &p : path) {
+      CHECK(planner.inside(p));
+    }
+    CHECK(path.back().IsEqual(gp_XY(25, 25), Precision::Confusion()));
+  }
+
+  SUBCASE("from the perimeter") {
+    // both ends on the outline, on either side of the notch
+    CHECK(planner.route(gp_XY(10, 20), gp_XY(20, 20), path));
+  }
+
+  SUBCASE("between islands") {
+    CHECK_FALSE(planner.route(gp_XY(5, 5), gp_XY(55, 5), path));
+  }
+}
+
+TEST_CASE("TravelPlanner comb test") {
+  // comb of 120 teeth, 1 wide and 25 long, on a 5 high base: hundreds of
+  // vertices, and routes between teeth that go down to the base and back
+  constexpr int teeth = 120;
+  auto points = std::vector<gp_XY>{{0, 0}, {2.0 * teeth, 0}};
+  for (int i = teeth - 1; i >= 0; --i) {
+    points.emplace_back(2.0 * i + 1, 5);
+    points.emplace_back(2.0 * i + 1, 30);
+    points.emplace_back(2.0 * i, 30);
+    points.emplace_back(2.0 * i, 5);
+  }
+  const auto planner = sse::TravelPlanner({polygon(points)}, 0.01, 0.1, 1000);
+  auto path = std::vector<gp_XY>();
+
+  for (int k = 0; k < 50; ++k) {
+    const auto a = gp_XY(2.0 * (k % teeth) + 0.5, 29);
+    const auto b = gp_XY(2.0 * ((k * 37 + 11) % teeth) + 0.5, 29);
+    REQUIRE(planner.route(a, b, path));
+    auto previous = a;
+    for (const auto &p : path) {
+      CHECK(planner.visible(previous, p));
+      previous = p;
+    }
+    CHECK(path.back().IsEqual(b, Precision::Confusion()));
+  }
+  CHECK_FALSE(planner.inside(gp_XY(1.5, 20)));
+  CHECK(planner.inside(gp_XY(1.5, 2)));
+}